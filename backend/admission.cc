@@ -0,0 +1,78 @@
+#include "admission.h"
+
+#include "core/guard.h"
+
+#include <algorithm>
+
+namespace backend {
+
+AdmissionController::AdmissionController(const Params& params)
+    : params_(params)
+    , limit_(static_cast<core::AtomicType>(std::clamp(params.initial_limit, params.min_limit, params.max_limit)))
+    , limit_gauge_(core::metrics::Registry::instance().gauge("chat_admission_limit")) {
+  limit_gauge_.set(limit_);
+}
+
+bool AdmissionController::TryAcquire(RpcMethod method) noexcept {
+  auto& in_flight = in_flight_[static_cast<size_t>(method)];
+  const auto per_method = core::atomics::Increment(in_flight);
+  const auto total = core::atomics::Increment(total_in_flight_);
+  if ((params_.max_in_flight_per_method != 0 &&
+       per_method > static_cast<core::AtomicType>(params_.max_in_flight_per_method)) ||
+      (params_.adaptive && total > core::atomics::Load(limit_))) {
+    core::atomics::Decrement(in_flight);
+    core::atomics::Decrement(total_in_flight_);
+    core::atomics::Increment(rejected_);
+    return false;
+  }
+  return true;
+}
+
+void AdmissionController::Release(RpcMethod method) noexcept {
+  core::atomics::Decrement(in_flight_[static_cast<size_t>(method)]);
+  core::atomics::Decrement(total_in_flight_);
+}
+
+void AdmissionController::Sample(RpcMethod method, core::Duration latency) noexcept {
+  if (!params_.adaptive) {
+    return;
+  }
+  core_with_lock(sample_lock_) {
+    // the minimum is taken over a sliding window so the baseline follows a storage that became slower for good
+    auto& latencies = latencies_[static_cast<size_t>(method)];
+    latencies.window_min = std::min(latencies.window_min, latency);
+    latencies.min = std::min(latencies.min, latency);
+    if (++latencies.window_samples == kMinLatencyWindow) {
+      latencies.min = latencies.window_min;
+      latencies.window_min = absl::InfiniteDuration();
+      latencies.window_samples = 0;
+    }
+
+    const auto limit = static_cast<size_t>(core::atomics::Load(limit_));
+    auto new_limit = limit;
+    if (latency > latencies.min * params_.latency_tolerance && !round_decreased_) {
+      // the slow calls completing after this one were admitted under the old limit, the round restarts
+      new_limit = std::max(params_.min_limit, limit * 9 / 10);
+      round_decreased_ = true;
+      round_saturated_ = false;
+      round_samples_ = 0;
+    } else {
+      round_saturated_ |= static_cast<size_t>(core::atomics::Load(total_in_flight_)) * 2 >= limit;
+      if (++round_samples_ >= limit) {
+        // only a round without congestion that used the limit grows it
+        if (!round_decreased_ && round_saturated_) {
+          new_limit = std::min(params_.max_limit, limit + 1);
+        }
+        round_decreased_ = false;
+        round_saturated_ = false;
+        round_samples_ = 0;
+      }
+    }
+    if (new_limit != limit) {
+      core::atomics::Store(limit_, static_cast<core::AtomicType>(new_limit));
+      limit_gauge_.set(static_cast<core::AtomicType>(new_limit));
+    }
+  }
+}
+
+}  // namespace backend
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "core/atomic.h"
+#include "core/datetime.h"
+#include "core/metrics.h"
+#include "core/spinlock.h"
+
+#include <array>
+#include <cstddef>
+
+namespace backend {
+
+enum class RpcMethod { kSendMessage, kSendMessages, kReceiveMessage, kSendedMessages, kSubscribe, kGetStats, kCount };
+
+// Decides whether a call may start its storage work. Every method has a fixed in-flight limit, and all methods
+// together are bounded by an adaptive limit that shrinks when the storage latency of a method grows above the
+// minimum observed for that method and grows back while latencies stay close to their minimums. The adaptive limit changes at most once per round, a round lasts
+// as many samples as the limit allows calls, like a congestion window changes once per round trip.
+class AdmissionController {
+ public:
+  struct Params {
+    // 0 disables the fixed per method limit
+    size_t max_in_flight_per_method = 0;
+    bool adaptive = false;
+    size_t initial_limit = 32;
+    size_t min_limit = 4;
+    size_t max_limit = 1024;
+    // latency above min_latency * tolerance counts as congestion
+    double latency_tolerance = 2.0;
+  };
+
+ public:
+  explicit AdmissionController(const Params& params);
+
+  // A successful TryAcquire must be paired with Release.
+  bool TryAcquire(RpcMethod method) noexcept;
+
+  void Release(RpcMethod method) noexcept;
+
+  // Storage latency of one admitted call, drives the adaptive limit. Methods are only compared with themselves, a
+  // commit is always slower than a read.
+  void Sample(RpcMethod method, core::Duration latency) noexcept;
+
+  inline auto Limit() const noexcept { return core::atomics::Load(limit_); }
+  inline auto Rejected() const noexcept { return core::atomics::Load(rejected_); }
+
+ private:
+  static constexpr size_t kMinLatencyWindow = 1000;
+
+  struct MethodLatency {
+    core::Duration min = absl::InfiniteDuration();
+    core::Duration window_min = absl::InfiniteDuration();
+    size_t window_samples = 0;
+  };
+
+  Params params_;
+
+  std::array<core::Atomic, static_cast<size_t>(RpcMethod::kCount)> in_flight_{};
+  core::Atomic total_in_flight_ = 0;
+  core::Atomic limit_;
+  core::Atomic rejected_ = 0;
+  core::metrics::Gauge& limit_gauge_;
+
+  core::SpinLock sample_lock_;
+  std::array<MethodLatency, static_cast<size_t>(RpcMethod::kCount)> latencies_{};
+  size_t round_samples_ = 0;
+  bool round_decreased_ = false;
+  bool round_saturated_ = false;
+};
+
+}  // namespace backend
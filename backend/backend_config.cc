@@ -1,5 +1,6 @@
 #include "backend_config.h"
 
+#include "core/cpu_set.h"
 #include "core/exception.h"
 #include "inicpp/inicpp.h"
 
@@ -15,6 +16,50 @@ backend::Config backend::LoadFromFile(std::string_view file) {
   try {
     auto server_config = inicpp::parser::load_file(std::string(file));
     result.threads_num = server_config["server"]["threads"].get<size_t>();
+    if (server_config["server"].contains("storage_threads")) {
+      result.storage_threads_num = server_config["server"]["storage_threads"].get<size_t>();
+    }
+    if (server_config["server"].contains("prepost_per_method")) {
+      result.prepost_per_method = server_config["server"]["prepost_per_method"].get<size_t>();
+    }
+    if (server_config["server"].contains("write_batch_window_us")) {
+      result.write_batch_window_us = server_config["server"]["write_batch_window_us"].get<uint64_t>();
+    }
+    if (server_config["server"].contains("write_batch_size")) {
+      result.write_batch_size = server_config["server"]["write_batch_size"].get<size_t>();
+    }
+    if (server_config["server"].contains("max_in_flight_per_method")) {
+      result.admission.max_in_flight_per_method = server_config["server"]["max_in_flight_per_method"].get<size_t>();
+    }
+    if (server_config["server"].contains("adaptive_concurrency")) {
+      result.admission.adaptive = server_config["server"]["adaptive_concurrency"].get<size_t>() != 0;
+    }
+    if (server_config["server"].contains("cpu_set")) {
+      // inicpp splits values on ',' into a list
+      std::string cpus;
+      for (const auto& item : server_config["server"]["cpu_set"].get_list<std::string>()) {
+        if (!cpus.empty()) {
+          cpus += ',';
+        }
+        cpus += item;
+      }
+      result.cpu_set = core::ParseCpuList(cpus);
+    }
+    if (server_config["server"].contains("numa_policy")) {
+      auto policy = server_config["server"]["numa_policy"].get<std::string>();
+      if (policy == "spread") {
+        result.numa_policy = NumaPolicy::kSpread;
+      } else if (policy != "none") {
+        core_throw core::Exception() << "unknown numa_policy `" << policy << "`";
+      }
+    }
+    if (server_config["server"].contains("trace_sample_one_in")) {
+      result.trace_sample_one_in = server_config["server"]["trace_sample_one_in"].get<size_t>();
+    }
+    if (server_config["server"].contains("trace_file")) {
+      result.trace_file = server_config["server"]["trace_file"].get<std::string>();
+    }
+    result.trace_file = std::filesystem::absolute(result.trace_file).string();
     result.pid_file = std::filesystem::absolute(server_config["server"]["pid"].get<std::string>()).string();
     result.host = server_config["server"]["host"].get<std::string>();
     result.port = server_config["server"]["port"].get<uint64_t>();
@@ -29,6 +74,10 @@ backend::Config backend::LoadFromFile(std::string_view file) {
     core_throw core::Exception() << e.what();
   }
 
+  if (!result.cpu_set.empty() && result.numa_policy != NumaPolicy::kNone) {
+    core_throw core::Exception() << "cpu_set and numa_policy can not be used together";
+  }
+
   if (!std::filesystem::exists(result.storage_config.storage_dll)) {
     core_throw core::Exception() << "Storage library `" + result.storage_config.storage_dll + "`doesn't exists";
   }
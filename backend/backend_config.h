@@ -1,16 +1,41 @@
 #pragma once
 
+#include "admission.h"
 #include "logging.h"
 
 #include "storage/config.h"
 
 #include <string>
 #include <string_view>
+#include <vector>
 
 namespace backend {
 
+// Placement of the completion queue threads on NUMA nodes.
+enum class NumaPolicy {
+  kNone,
+  // thread i runs on the CPUs of node i % node count
+  kSpread,
+};
+
 struct Config {
-  size_t threads_num;
+  size_t threads_num = 1;
+  // 0 keeps storage calls on the completion queue threads
+  size_t storage_threads_num = 0;
+  // calls of every method waiting for a request on each completion queue
+  size_t prepost_per_method = 1;
+  // 0 disables the group commit of SendMessage
+  uint64_t write_batch_window_us = 0;
+  size_t write_batch_size = 64;
+  AdmissionController::Params admission;
+  // completion queue thread i is pinned to cpu_set[i % size], storage threads to the whole set. Under kSpread the
+  // storage threads run on the nodes of the completion queue threads.
+  std::vector<size_t> cpu_set;
+  NumaPolicy numa_policy = NumaPolicy::kNone;
+  // one of this many calls of every completion queue thread is traced, 0 disables tracing
+  size_t trace_sample_one_in = 0;
+  // SIGUSR1 writes the spans of the traced calls here
+  std::string trace_file = "trace.json";
 
   std::string pid_file;
   std::string host;
@@ -0,0 +1,123 @@
+#include "backend/server.h"
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "grpcpp/grpcpp.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+ABSL_FLAG(std::string, address, "unix:/tmp/chat_accept_latency.sock", "Address the benchmarked server listens on");
+ABSL_FLAG(size_t, threads, 1, "Completion queue threads of the server");
+ABSL_FLAG(size_t, burst, 64, "Concurrent SendMessage calls issued at once");
+ABSL_FLAG(size_t, rounds, 200, "Bursts per configuration");
+ABSL_FLAG(std::vector<std::string>, prepost, std::vector<std::string>({"1", "4", "16", "64"}),
+          "prepost_per_method values to compare");
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Keeps the storage out of the measurement, only accepting and answering calls is left.
+struct NullStorage final : public storage::IStorage {
+  Uids Store(const proto::Message& message) override { return Uids(message.to_size(), 0); }
+
+  std::vector<proto::Message> Load(const std::vector<std::string>& /* possible_addressees */) override { return {}; }
+
+  std::vector<proto::Message> LoadSended(const std::string& /* user */) override { return {}; }
+};
+
+struct PendingCall {
+  grpc::ClientContext context;
+  proto::SendResponse response;
+  grpc::Status status;
+  std::unique_ptr<grpc::ClientAsyncResponseReader<proto::SendResponse>> reader;
+  Clock::time_point start;
+};
+
+std::vector<double> RunBursts(proto::ChatRpc::Stub* stub, size_t burst, size_t rounds) {
+  proto::SendRequest request;
+  request.mutable_message()->set_from("bench");
+  request.mutable_message()->add_to("bench");
+  request.mutable_message()->set_message("accept latency");
+
+  std::vector<double> latencies_us;
+  latencies_us.reserve(burst * rounds);
+
+  grpc::CompletionQueue cq;
+  for (size_t round = 0; round < rounds; ++round) {
+    std::vector<PendingCall> calls(burst);
+    for (auto& call : calls) {
+      call.start = Clock::now();
+      call.reader = stub->AsyncSendMessage(&call.context, request, &cq);
+      call.reader->Finish(&call.response, &call.status, &call);
+    }
+    for (size_t done = 0; done < burst; ++done) {
+      void* tag;
+      bool ok;
+      if (!cq.Next(&tag, &ok)) {
+        return latencies_us;
+      }
+      auto* call = static_cast<PendingCall*>(tag);
+      if (!ok || !call->status.ok()) {
+        std::cerr << "call failed: " << call->status.error_message() << "\n";
+        continue;
+      }
+      latencies_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - call->start).count());
+    }
+  }
+  cq.Shutdown();
+  return latencies_us;
+}
+
+double Percentile(const std::vector<double>& sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * static_cast<double>(sorted.size())))];
+}
+
+}  // namespace
+
+// Measures how long a burst of concurrent SendMessage calls waits to be accepted and answered
+// for different numbers of calls pre-posted per method.
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+
+  const auto address = absl::GetFlag(FLAGS_address);
+  const auto burst = absl::GetFlag(FLAGS_burst);
+  const auto rounds = absl::GetFlag(FLAGS_rounds);
+
+  std::cout << std::setw(10) << "prepost" << std::setw(12) << "mean_us" << std::setw(12) << "p50_us" << std::setw(12)
+            << "p99_us" << std::setw(12) << "max_us"
+            << "\n";
+
+  for (const auto& value : absl::GetFlag(FLAGS_prepost)) {
+    const size_t prepost = std::stoul(value);
+
+    backend::Config config;
+    config.threads_num = absl::GetFlag(FLAGS_threads);
+    config.prepost_per_method = prepost;
+    backend::RpcServer server(config, std::make_unique<NullStorage>());
+    server.Start(address);
+
+    auto stub = proto::ChatRpc::NewStub(grpc::CreateChannel(address, grpc::InsecureChannelCredentials()));
+    RunBursts(stub.get(), burst, rounds / 10 + 1);  // warm up the channel and the call pools
+    auto latencies = RunBursts(stub.get(), burst, rounds);
+    server.Stop();
+
+    std::sort(latencies.begin(), latencies.end());
+    const double mean =
+        latencies.empty() ? 0 : std::accumulate(latencies.begin(), latencies.end(), 0.0) / latencies.size();
+    std::cout << std::fixed << std::setprecision(1) << std::setw(10) << prepost << std::setw(12) << mean
+              << std::setw(12) << Percentile(latencies, 0.5) << std::setw(12) << Percentile(latencies, 0.99)
+              << std::setw(12) << Percentile(latencies, 1.0) << "\n";
+  }
+  return 0;
+}
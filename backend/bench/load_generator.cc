@@ -0,0 +1,379 @@
+#include "backend/server.h"
+
+#include "core/metrics.h"
+#include "storage/api.h"
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "grpcpp/grpcpp.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+ABSL_FLAG(std::string, address, "unix:/tmp/chat_load_generator.sock", "Address of the server under load");
+ABSL_FLAG(std::string, storage_library, "storage/in_memory/libin_memory_storage.so",
+          "Storage DLL of a server started in process on --address, empty loads an already running server");
+ABSL_FLAG(std::string, storage_config, "", "Config file passed to the storage DLL");
+ABSL_FLAG(size_t, server_threads, 2, "Completion queue threads of the in process server");
+ABSL_FLAG(size_t, storage_threads, 0, "Storage pool threads of the in process server");
+
+ABSL_FLAG(size_t, channels, 8, "Client channels, each has its own connection");
+ABSL_FLAG(size_t, client_threads, 2, "Client completion queue threads, channels are shared out between them");
+ABSL_FLAG(size_t, concurrency, 64, "Outstanding calls per client thread when --rate is 0");
+ABSL_FLAG(double, rate, 0, "Calls per second over all client threads, 0 runs a closed loop as fast as possible");
+ABSL_FLAG(double, duration_s, 10, "Measured run time");
+ABSL_FLAG(double, warmup_s, 1, "Run time before the measurement starts");
+ABSL_FLAG(size_t, call_timeout_ms, 10000, "Deadline of every call");
+
+ABSL_FLAG(std::string, mix, "send=8,receive=1,sended=1", "Relative weights of SendMessage, ReceiveMessage and "
+                                                         "SendedMessages calls");
+ABSL_FLAG(size_t, users, 1000, "Distinct user names messages are sent from and to");
+ABSL_FLAG(size_t, fanout, 1, "Recipients of a message sent to users");
+ABSL_FLAG(size_t, groups, 10, "Groups of users messages may be sent to");
+ABSL_FLAG(size_t, group_size, 10, "Members of a group, a message to a group lists all of them as recipients");
+ABSL_FLAG(double, group_ratio, 0, "Fraction of messages sent to a group instead of --fanout users");
+ABSL_FLAG(size_t, message_bytes, 64, "Message text size");
+ABSL_FLAG(size_t, receive_limit, 100, "Page size of ReceiveMessage calls, 0 loads the whole mailbox");
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum class Op { kSend, kReceive, kSended, kCount };
+
+constexpr std::array<const char*, static_cast<size_t>(Op::kCount)> kOpNames = {"SendMessage", "ReceiveMessage",
+                                                                                 "SendedMessages"};
+
+struct Options {
+  size_t concurrency;
+  std::chrono::milliseconds call_timeout;
+  double rate_per_thread;
+  std::array<double, static_cast<size_t>(Op::kCount)> mix;
+  size_t users;
+  size_t fanout;
+  size_t groups;
+  size_t group_size;
+  double group_ratio;
+  std::string text;
+  size_t receive_limit;
+};
+
+// Results of all client threads, histograms and counters are safe to update concurrently.
+struct Results {
+  std::array<core::metrics::Histogram, static_cast<size_t>(Op::kCount)> latency;
+  std::array<core::metrics::Counter, static_cast<size_t>(Op::kCount)> errors;
+  std::atomic<bool> recording{false};
+};
+
+std::array<double, static_cast<size_t>(Op::kCount)> ParseMix(const std::string& mix) {
+  std::array<double, static_cast<size_t>(Op::kCount)> result{};
+  static constexpr std::array<const char*, static_cast<size_t>(Op::kCount)> kKeys = {"send", "receive", "sended"};
+  std::stringstream in(mix);
+  std::string item;
+  while (std::getline(in, item, ',')) {
+    const auto eq = item.find('=');
+    size_t op = 0;
+    while (op < kKeys.size() && item.compare(0, eq, kKeys[op]) != 0) {
+      ++op;
+    }
+    if (eq == std::string::npos || op == kKeys.size()) {
+      std::cerr << "bad --mix item `" << item << "`\n";
+      exit(1);
+    }
+    result[op] = std::stod(item.substr(eq + 1));
+  }
+  if (std::accumulate(result.begin(), result.end(), 0.0) <= 0) {
+    std::cerr << "--mix has no calls\n";
+    exit(1);
+  }
+  return result;
+}
+
+struct Call {
+  virtual ~Call() = default;
+
+  Op op;
+  Clock::time_point start;
+  grpc::ClientContext context;
+  grpc::Status status;
+};
+
+template <class Response>
+struct TypedCall final : public Call {
+  Response response;
+  std::unique_ptr<grpc::ClientAsyncResponseReader<Response>> reader;
+};
+
+class Worker {
+ public:
+  Worker(const Options& options, Results* results, std::vector<std::unique_ptr<proto::ChatRpc::Stub>> stubs,
+         uint64_t seed)
+      : options_(options)
+      , results_(results)
+      , stubs_(std::move(stubs))
+      , random_(seed)
+      , op_(options.mix.begin(), options.mix.end()) {}
+
+  void Run(Clock::time_point until) {
+    if (options_.rate_per_thread > 0) {
+      RunOpenLoop(until);
+    } else {
+      RunClosedLoop(until);
+    }
+    cq_.Shutdown();
+    void* tag;
+    bool ok;
+    while (cq_.Next(&tag, &ok)) {
+      delete static_cast<Call*>(tag);
+    }
+  }
+
+ private:
+  void RunClosedLoop(Clock::time_point until) {
+    for (size_t i = 0; i < options_.concurrency; ++i) {
+      Issue(Clock::now());
+    }
+    void* tag;
+    bool ok;
+    while (outstanding_ > 0 && cq_.Next(&tag, &ok)) {
+      Complete(static_cast<Call*>(tag), ok);
+      if (Clock::now() < until) {
+        Issue(Clock::now());
+      }
+    }
+  }
+
+  // Calls start on a fixed schedule whether or not earlier ones are done, and their latency is counted from the
+  // scheduled time, so a stalled server shows up in the tail instead of slowing the load down.
+  void RunOpenLoop(Clock::time_point until) {
+    const auto interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / options_.rate_per_thread));
+    auto next = Clock::now();
+    void* tag;
+    bool ok;
+    while (next < until || outstanding_ > 0) {
+      for (const auto now = Clock::now(); next <= now && next < until; next += interval) {
+        Issue(next);
+      }
+      // grpc takes system clock deadlines only
+      const auto wait = next < until ? next - Clock::now() : Clock::duration(std::chrono::milliseconds(100));
+      switch (cq_.AsyncNext(&tag, &ok, std::chrono::system_clock::now() + wait)) {
+        case grpc::CompletionQueue::GOT_EVENT:
+          Complete(static_cast<Call*>(tag), ok);
+          break;
+        case grpc::CompletionQueue::TIMEOUT:
+          break;
+        case grpc::CompletionQueue::SHUTDOWN:
+          return;
+      }
+    }
+  }
+
+  void Issue(Clock::time_point start) {
+    auto* stub = stubs_[next_stub_++ % stubs_.size()].get();
+    const auto op = static_cast<Op>(op_(random_));
+    switch (op) {
+      case Op::kSend: {
+        proto::SendRequest request;
+        FillMessage(request.mutable_message());
+        Start<proto::SendResponse>(op, start, [&](grpc::ClientContext* context) {
+          return stub->AsyncSendMessage(context, request, &cq_);
+        });
+        break;
+      }
+      case Op::kReceive: {
+        proto::ReceiveRequest request;
+        request.set_user(UserName(RandomUser()));
+        request.set_limit(options_.receive_limit);
+        Start<proto::ReceiveResponse>(op, start, [&](grpc::ClientContext* context) {
+          return stub->AsyncReceiveMessage(context, request, &cq_);
+        });
+        break;
+      }
+      case Op::kSended: {
+        proto::FromRequest request;
+        request.set_user(UserName(RandomUser()));
+        Start<proto::FromResponse>(op, start, [&](grpc::ClientContext* context) {
+          return stub->AsyncSendedMessages(context, request, &cq_);
+        });
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  template <class Response, class F>
+  void Start(Op op, Clock::time_point start, F&& async_call) {
+    auto* call = new TypedCall<Response>();
+    call->op = op;
+    call->start = start;
+    call->context.set_deadline(std::chrono::system_clock::now() + options_.call_timeout);
+    call->reader = async_call(&call->context);
+    call->reader->Finish(&call->response, &call->status, call);
+    ++outstanding_;
+  }
+
+  void Complete(Call* call, bool ok) {
+    --outstanding_;
+    if (results_->recording.load(std::memory_order_relaxed)) {
+      const auto op = static_cast<size_t>(call->op);
+      if (ok && call->status.ok()) {
+        results_->latency[op].record(absl::FromChrono(Clock::now() - call->start));
+      } else {
+        results_->errors[op].inc();
+      }
+    }
+    delete call;
+  }
+
+  void FillMessage(proto::Message* message) {
+    message->set_from(UserName(RandomUser()));
+    if (options_.groups > 0 && std::bernoulli_distribution(options_.group_ratio)(random_)) {
+      const size_t first = std::uniform_int_distribution<size_t>(0, options_.groups - 1)(random_) * options_.group_size;
+      for (size_t i = 0; i < options_.group_size; ++i) {
+        message->add_to(UserName((first + i) % options_.users));
+      }
+    } else {
+      for (size_t i = 0; i < options_.fanout; ++i) {
+        message->add_to(UserName(RandomUser()));
+      }
+    }
+    message->set_message(options_.text);
+    message->set_send_ts(static_cast<uint64_t>(absl::ToUnixSeconds(absl::Now())));
+  }
+
+  size_t RandomUser() { return std::uniform_int_distribution<size_t>(0, options_.users - 1)(random_); }
+
+  static std::string UserName(size_t user) { return "load_user" + std::to_string(user); }
+
+ private:
+  const Options& options_;
+  Results* results_;
+  std::vector<std::unique_ptr<proto::ChatRpc::Stub>> stubs_;
+  grpc::CompletionQueue cq_;
+  std::mt19937_64 random_;
+  std::discrete_distribution<size_t> op_;
+  size_t next_stub_ = 0;
+  size_t outstanding_ = 0;
+};
+
+void PrintRow(const std::string& name, size_t calls, size_t errors, double seconds,
+              const core::metrics::HistogramSnapshot& latency) {
+  const auto us = [&](double q) { return static_cast<double>(latency.valueAtQuantile(q)) / 1000; };
+  std::cout << std::left << std::setw(16) << name << std::right << std::setw(10) << calls << std::setw(8) << errors
+            << std::setw(12) << static_cast<double>(calls) / seconds << std::setw(12) << us(0.5) << std::setw(12)
+            << us(0.99) << std::setw(12) << us(0.999) << std::setw(12) << static_cast<double>(latency.max) / 1000
+            << "\n";
+}
+
+}  // namespace
+
+// Drives a mix of unary calls against a chat server over many channels and reports throughput and latency
+// percentiles per method.
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+
+  const auto address = absl::GetFlag(FLAGS_address);
+  const auto client_threads = std::max<size_t>(absl::GetFlag(FLAGS_client_threads), 1);
+  const auto channels = std::max(absl::GetFlag(FLAGS_channels), client_threads);
+
+  Options options;
+  options.concurrency = std::max<size_t>(absl::GetFlag(FLAGS_concurrency), 1);
+  options.call_timeout = std::chrono::milliseconds(absl::GetFlag(FLAGS_call_timeout_ms));
+  options.rate_per_thread = absl::GetFlag(FLAGS_rate) / static_cast<double>(client_threads);
+  options.mix = ParseMix(absl::GetFlag(FLAGS_mix));
+  options.users = std::max<size_t>(absl::GetFlag(FLAGS_users), 1);
+  options.fanout = std::max<size_t>(absl::GetFlag(FLAGS_fanout), 1);
+  options.groups = absl::GetFlag(FLAGS_groups);
+  options.group_size = std::max<size_t>(absl::GetFlag(FLAGS_group_size), 1);
+  options.group_ratio = absl::GetFlag(FLAGS_group_ratio);
+  options.text = std::string(absl::GetFlag(FLAGS_message_bytes), 'x');
+  options.receive_limit = absl::GetFlag(FLAGS_receive_limit);
+
+  std::unique_ptr<backend::RpcServer> server;
+  if (!absl::GetFlag(FLAGS_storage_library).empty()) {
+    backend::Config config;
+    config.threads_num = absl::GetFlag(FLAGS_server_threads);
+    config.storage_threads_num = absl::GetFlag(FLAGS_storage_threads);
+    config.prepost_per_method = 16;
+    storage::Config storage_config{absl::GetFlag(FLAGS_storage_library), absl::GetFlag(FLAGS_storage_config)};
+    server = std::make_unique<backend::RpcServer>(config, storage::CreateStorage(storage_config));
+    server->Start(address);
+  }
+
+  Results results;
+  std::vector<std::unique_ptr<Worker>> workers;
+  for (size_t t = 0; t < client_threads; ++t) {
+    std::vector<std::unique_ptr<proto::ChatRpc::Stub>> stubs;
+    for (size_t c = t; c < channels; c += client_threads) {
+      // channels with equal arguments would share one connection
+      grpc::ChannelArguments args;
+      args.SetInt("chat.load_generator.channel", static_cast<int>(c));
+      stubs.push_back(
+          proto::ChatRpc::NewStub(grpc::CreateCustomChannel(address, grpc::InsecureChannelCredentials(), args)));
+    }
+    workers.push_back(std::make_unique<Worker>(options, &results, std::move(stubs), t + 1));
+  }
+
+  const auto seconds = [](double s) {
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(s));
+  };
+  const auto measure_start = Clock::now() + seconds(absl::GetFlag(FLAGS_warmup_s));
+  const auto until = measure_start + seconds(absl::GetFlag(FLAGS_duration_s));
+
+  std::vector<std::thread> threads;
+  for (auto& worker : workers) {
+    threads.emplace_back([&worker, until] { worker->Run(until); });
+  }
+  std::this_thread::sleep_until(measure_start);
+  results.recording.store(true);
+  std::this_thread::sleep_until(until);
+  const auto measured = std::chrono::duration<double>(Clock::now() - measure_start).count();
+  results.recording.store(false);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  if (server) {
+    server->Stop();
+  }
+
+  std::cout << std::left << std::setw(16) << "method" << std::right << std::setw(10) << "calls" << std::setw(8)
+            << "errors" << std::setw(12) << "calls/s" << std::setw(12) << "p50_us" << std::setw(12) << "p99_us"
+            << std::setw(12) << "p999_us" << std::setw(12) << "max_us"
+            << "\n"
+            << std::fixed << std::setprecision(1);
+
+  core::metrics::HistogramSnapshot total;
+  total.buckets.resize(core::metrics::Histogram::kBuckets);
+  size_t total_errors = 0;
+  for (size_t op = 0; op < static_cast<size_t>(Op::kCount); ++op) {
+    if (options.mix[op] <= 0) {
+      continue;
+    }
+    const auto latency = results.latency[op].snapshot();
+    const auto errors = static_cast<size_t>(results.errors[op].value());
+    PrintRow(kOpNames[op], latency.count, errors, measured, latency);
+    total.count += latency.count;
+    total.sum += latency.sum;
+    total.max = std::max(total.max, latency.max);
+    for (size_t i = 0; i < latency.buckets.size(); ++i) {
+      total.buckets[i] += latency.buckets[i];
+    }
+    total_errors += errors;
+  }
+  PrintRow("total", total.count, total_errors, measured, total);
+  return 0;
+}
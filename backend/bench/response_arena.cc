@@ -0,0 +1,113 @@
+#include "backend/call_arena.h"
+#include "proto/receive.pb.h"
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+ABSL_FLAG(std::vector<std::string>, mailbox, std::vector<std::string>({"10", "100", "1000", "10000"}),
+          "Mailbox sizes to build a ReceiveResponse for");
+ABSL_FLAG(size_t, iterations, 200, "Responses built per mailbox size and mode");
+
+static std::atomic<size_t> allocations{0};
+
+// Kept out of line, otherwise the compiler pairs the inlined malloc/free with new/delete expressions and warns.
+__attribute__((noinline)) void* operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept { std::free(p); }
+
+__attribute__((noinline)) void operator delete(void* p, size_t /* size */) noexcept { std::free(p); }
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::vector<proto::Message> Mailbox(size_t size) {
+  std::vector<proto::Message> result(size);
+  for (size_t i = 0; i < size; ++i) {
+    result[i].set_message_uid(i);
+    result[i].set_from("sender-" + std::to_string(i % 17));
+    result[i].add_to("receiver");
+    result[i].add_to("#all");
+    result[i].set_send_ts(1600000000 + i);
+    result[i].set_message(std::string(64 + i % 64, 'x'));
+  }
+  return result;
+}
+
+struct Result {
+  double allocations_per_call;
+  double us_per_call;
+};
+
+// What the calls did before the arena: a heap response filled from the storage result.
+Result Heap(const std::vector<proto::Message>& mailbox, size_t iterations) {
+  std::string wire;
+  const size_t before = allocations.load();
+  const auto start = Clock::now();
+  for (size_t i = 0; i < iterations; ++i) {
+    proto::ReceiveResponse response;
+    *response.mutable_messages() = {mailbox.begin(), mailbox.end()};
+    response.set_status(proto::Status::kOk);
+    response.SerializeToString(&wire);
+  }
+  const auto elapsed = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  return {static_cast<double>(allocations.load() - before) / iterations, elapsed / iterations};
+}
+
+// A recycled call: the response lives on the call arena, which is reset before every call.
+Result Arena(const std::vector<proto::Message>& mailbox, size_t iterations) {
+  backend::CallArena arena;
+  std::string wire;
+  const size_t before = allocations.load();
+  const auto start = Clock::now();
+  for (size_t i = 0; i < iterations; ++i) {
+    arena.Reset();
+    auto* response = arena.Create<proto::ReceiveResponse>();
+    response->mutable_messages()->Reserve(static_cast<int>(mailbox.size()));
+    for (const auto& message : mailbox) {
+      *response->add_messages() = message;
+    }
+    response->set_status(proto::Status::kOk);
+    response->SerializeToString(&wire);
+  }
+  const auto elapsed = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  return {static_cast<double>(allocations.load() - before) / iterations, elapsed / iterations};
+}
+
+}  // namespace
+
+// Allocations and time spent filling and serializing a ReceiveResponse, with and without the call arena.
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+  const auto iterations = absl::GetFlag(FLAGS_iterations);
+
+  std::cout << std::setw(10) << "mailbox" << std::setw(16) << "heap_allocs" << std::setw(16) << "arena_allocs"
+            << std::setw(12) << "heap_us" << std::setw(12) << "arena_us"
+            << "\n";
+  for (const auto& value : absl::GetFlag(FLAGS_mailbox)) {
+    const auto mailbox = Mailbox(std::stoul(value));
+    Heap(mailbox, 1);
+    Arena(mailbox, 1);
+    const auto heap = Heap(mailbox, iterations);
+    const auto arena = Arena(mailbox, iterations);
+    std::cout << std::fixed << std::setprecision(1) << std::setw(10) << mailbox.size() << std::setw(16)
+              << heap.allocations_per_call << std::setw(16) << arena.allocations_per_call << std::setw(12)
+              << heap.us_per_call << std::setw(12) << arena.us_per_call << "\n";
+  }
+  return 0;
+}
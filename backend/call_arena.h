@@ -0,0 +1,43 @@
+#pragma once
+
+#include "google/protobuf/arena.h"
+
+#include <memory>
+
+namespace backend {
+
+// Arena for the protos of one call. The first block belongs to the call object and survives Reset(), so a recycled
+// call with a small response allocates nothing.
+class CallArena {
+ public:
+  CallArena()
+      : initial_block_(new char[kInitialBlockSize])
+      , arena_(Options(initial_block_.get())) {}
+
+  inline google::protobuf::Arena* get() noexcept { return &arena_; }
+
+  template <class T>
+  inline T* Create() {
+    return google::protobuf::Arena::CreateMessage<T>(&arena_);
+  }
+
+  inline void Reset() { arena_.Reset(); }
+
+ private:
+  static constexpr size_t kInitialBlockSize = 16 << 10;
+  static constexpr size_t kMaxBlockSize = 1 << 20;
+
+  static google::protobuf::ArenaOptions Options(char* initial_block) noexcept {
+    google::protobuf::ArenaOptions options;
+    options.initial_block = initial_block;
+    options.initial_block_size = kInitialBlockSize;
+    options.max_block_size = kMaxBlockSize;
+    return options;
+  }
+
+ private:
+  std::unique_ptr<char[]> initial_block_;
+  google::protobuf::Arena arena_;
+};
+
+}  // namespace backend
@@ -2,9 +2,11 @@
 #include "logging.h"
 #include "user_groups.h"
 
+#include "core/async.h"
 #include "core/exception.h"
 
-static auto ExpandUserName(std::string_view user_name) noexcept {
+static auto ExpandUserName(std::string_view user_name, uint64_t trace_id) noexcept {
+  core::trace::ScopedSpan span("ExpandUserName", trace_id);
   auto r = backend::GetUserGroups(user_name);
   if (backend::GetUserType(user_name) == backend::LoginType::kUserName) {
     r.emplace_back(user_name);
@@ -15,11 +17,12 @@ static auto ExpandUserName(std::string_view user_name) noexcept {
 
 namespace backend {
 
-ICallData::ICallData(proto::ChatRpc::AsyncService* service, grpc::ServerCompletionQueue* cq, storage::IStorage* storage)
-    : service_(service)
+ICallData::ICallData(const CallEnvironment* env, grpc::ServerCompletionQueue* cq, RpcMethod method)
+    : env_(env)
     , completion_queue_(cq)
-    , storage_(storage)
-    , status_(CallStatus::kCreate) {}
+    , method_(method)
+    , status_(CallStatus::kCreate)
+    , metrics_(&MethodMetrics(method)) {}
 
 void ICallData::Proceed() {
   switch (status_) {
@@ -27,9 +30,25 @@ void ICallData::Proceed() {
       DoCreate();
       break;
     case CallStatus::kProcess:
-      DoProcess();
+      process_start_ = core::Time::now();
+      metrics_->calls.inc();
+      trace_id_ = core::trace::StartTrace();
+      if (trace_id_ != 0) {
+        trace_start_ns_ = core::trace::Now();
+        if (current_dequeue.end_ns != 0) {
+          core::trace::Record("cq.dequeue", trace_id_, current_dequeue.start_ns, current_dequeue.end_ns);
+        }
+      }
+      {
+        core::trace::ScopedSpan span("DoProcess", trace_id_);
+        DoProcess();
+      }
       break;
     case CallStatus::kFinish:
+      metrics_->total.record(core::Time::now() - process_start_);
+      if (trace_id_ != 0) {
+        core::trace::Record(MethodName(method_), trace_id_, trace_start_ns_, core::trace::Now());
+      }
       DoFinish();
       break;
     default:
@@ -38,81 +57,355 @@ void ICallData::Proceed() {
   }
 }
 
-SendCallData::SendCallData(proto::ChatRpc::AsyncService* service, grpc::ServerCompletionQueue* cq,
-                           storage::IStorage* storage)
-    : ICallData(service, cq, storage)
-    , responder_(&context_) {
-  Proceed();
+bool ICallData::Admit() {
+  reject_status_ = CheckDeadline();
+  if (reject_status_.ok() && env_->admission != nullptr && !env_->admission->TryAcquire(method_)) {
+    reject_status_ = grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED, "server is overloaded, retry later");
+  }
+  if (!reject_status_.ok()) {
+    Respond();
+    return false;
+  }
+  return true;
 }
 
-ReceiveCallData::ReceiveCallData(proto::ChatRpc::AsyncService* service, grpc::ServerCompletionQueue* cq,
-                                 storage::IStorage* storage)
-    : ICallData(service, cq, storage)
-    , responder_(&context_) {
-  Proceed();
+void ICallData::ReleaseAdmission(core::Duration storage_time) {
+  if (env_->admission != nullptr) {
+    env_->admission->Sample(method_, storage_time);
+    env_->admission->Release(method_);
+  }
 }
 
-FromCallData::FromCallData(proto::ChatRpc::AsyncService* service, grpc::ServerCompletionQueue* cq,
-                           storage::IStorage* storage)
-    : ICallData(service, cq, storage)
-    , responder_(&context_) {
+void ICallData::ProcessStorageWork() {
+  if (!Admit()) {
+    return;
+  }
+
+  enqueue_time_ = core::Time::now();
+  if (trace_id_ != 0) {
+    trace_enqueue_ns_ = core::trace::Now();
+  }
+  if (env_->storage_pool != nullptr) {
+    try {
+      core::Async([this] { RunStorageWork(); }, *env_->storage_pool).subscribe([this](const core::Future<void>&) {
+        Respond();
+      });
+      return;
+    } catch (const core::ThreadPoolException& e) {
+      chat_log_warn("{}", e.what());
+    }
+  }
+  RunStorageWork();
+  Respond();
+}
+
+grpc::Status ICallData::CheckDeadline() const {
+  // IsCancelled() is only safe after an AsyncNotifyWhenDone tag, the deadline is always known
+  if (Context().deadline() <= std::chrono::system_clock::now()) {
+    return grpc::Status(grpc::StatusCode::DEADLINE_EXCEEDED, "deadline exceeded before storage work");
+  }
+  return grpc::Status::OK;
+}
+
+void ICallData::RunStorageWork() {
+  const auto start = core::Time::now();
+  metrics_->queue.record(start - enqueue_time_);
+  if (trace_id_ != 0) {
+    core::trace::Record("storage.queue", trace_id_, trace_enqueue_ns_, core::trace::Now());
+  }
+  // the call may have waited in the storage pool queue past its deadline
+  reject_status_ = CheckDeadline();
+  if (!reject_status_.ok()) {
+    if (env_->admission != nullptr) {
+      env_->admission->Release(method_);
+    }
+    return;
+  }
+  DoStorageWork();
+  const auto storage_time = core::Time::now() - start;
+  metrics_->storage.record(storage_time);
+  ReleaseAdmission(storage_time);
+}
+
+void ICallData::Respond() {
+  // the call may be finished and reused by its completion queue thread as soon as the response is handed over
+  const auto* metrics = metrics_;
+  core::trace::ScopedSpan span("Finish", trace_id_);
+  const auto start = core::Time::now();
+  if (reject_status_.ok()) {
+    DoRespond();
+  } else {
+    metrics->rejected.inc();
+    DoRespondError(reject_status_);
+  }
+  metrics->respond.record(core::Time::now() - start);
+}
+
+template <class T>
+static void DeleteAll(const std::vector<T*>& calls) {
+  for (auto* call : calls) {
+    delete call;
+  }
+}
+
+CallDataPool::CallDataPool()
+    : hits_(core::metrics::Registry::instance().counter("chat_call_pool_hits_total"))
+    , misses_(core::metrics::Registry::instance().counter("chat_call_pool_misses_total")) {}
+
+CallDataPool::~CallDataPool() {
+  std::apply([](const auto&... lists) { (DeleteAll(lists), ...); }, free_);
+}
+
+SubscribeCallData::SubscribeCallData(const CallEnvironment* env, grpc::ServerCompletionQueue* cq)
+    : ICallData(env, cq, RpcMethod::kSubscribe)
+    , ISubscriber(1)
+    , writer_(&context_)
+    , write_tag_(this, &SubscribeCallData::OnWriteDone)
+    , done_tag_(this, &SubscribeCallData::OnDone) {
   Proceed();
 }
 
 void SendCallData::DoProcess() {
-  new SendCallData(service_, completion_queue_, storage_);
+  SpawnNext();
+  if (env_->write_coalescer == nullptr) {
+    ProcessStorageWork();
+  } else if (Admit()) {
+    storage_start_ = core::Time::now();
+    trace_submit_ns_ = trace_id_ == 0 ? 0 : core::trace::Now();
+    env_->write_coalescer->Submit(request_->message(), this);
+  }
+}
+
+void SendCallData::DoStorageWork() {
+  storage::IStorage::Uids uids;
   try {
-    chat_server_log("start storing message");
-    storage_->Store(request_.message());
-    response_.set_status(proto::Status::kOk);
-    chat_server_log("stop storing message");
+    chat_log_debug("start storing message");
+    {
+      core::trace::ScopedSpan span("storage.Store", trace_id_);
+      uids = env_->storage->Store(request_->message());
+    }
+    response_->set_status(proto::Status::kOk);
+    chat_log_debug("stop storing message");
+    env_->subscribers->Publish(request_->message(), uids);
   } catch (const core::Exception& e) {
-    chat_server_log(e.what());
-    class core::BackTrace bt;
-    bt.capture();
-    chat_server_log(bt.toString());
-    response_.set_status(proto::Status::kError);
+    backend::LogStorageError(e);
+    response_->set_status(proto::Status::kError);
+  }
+}
+
+void SendCallData::OnStored(bool stored, const storage::IStorage::Uids& uids, core::Duration store_time) {
+  metrics_->storage.record(core::Time::now() - storage_start_);
+  if (trace_id_ != 0) {
+    core::trace::Record("storage.WriteCoalescer", trace_id_, trace_submit_ns_, core::trace::Now());
+  }
+  // the window the message waited for its batch is not storage congestion
+  ReleaseAdmission(store_time);
+  if (stored) {
+    response_->set_status(proto::Status::kOk);
+    env_->subscribers->Publish(request_->message(), uids);
+  } else {
+    response_->set_status(proto::Status::kError);
+  }
+  Respond();
+}
+
+void SendBatchCallData::DoProcess() {
+  SpawnNext();
+  ProcessStorageWork();
+}
+
+void SendBatchCallData::DoStorageWork() {
+  try {
+    chat_log_debug("start storing message batch");
+    std::vector<bool> stored;
+    std::vector<storage::IStorage::Uids> uids;
+    {
+      core::trace::ScopedSpan span("storage.StoreBatch", trace_id_);
+      stored = env_->storage->StoreBatch(request_->messages(), &uids);
+    }
+    // the storage is a plugin, a result of another size fails the whole batch like a throw does
+    if (stored.size() != static_cast<size_t>(request_->messages_size())) {
+      core_throw core::Exception() << "storage returned " << stored.size() << " results for a batch of "
+                                   << request_->messages_size() << " messages";
+    }
+    // a storage that does not report uids publishes the messages as sent
+    uids.resize(request_->messages_size());
+    bool all_stored = true;
+    for (int i = 0; i < request_->messages_size(); ++i) {
+      if (stored[i]) {
+        response_->add_statuses(proto::Status::kOk);
+        env_->subscribers->Publish(request_->messages(i), uids[i]);
+      } else {
+        response_->add_statuses(proto::Status::kError);
+        all_stored = false;
+      }
+    }
+    response_->set_status(all_stored ? proto::Status::kOk : proto::Status::kError);
+    chat_log_debug("stop storing message batch");
+  } catch (const core::Exception& e) {
+    backend::LogStorageError(e);
+    response_->clear_statuses();
+    for (int i = 0; i < request_->messages_size(); ++i) {
+      response_->add_statuses(proto::Status::kError);
+    }
+    response_->set_status(proto::Status::kError);
   }
-  SetStatus(CallStatus::kFinish);
-  responder_.Finish(response_, grpc::Status::OK, this);
 }
 
 void ReceiveCallData::DoProcess() {
-  new ReceiveCallData(service_, completion_queue_, storage_);
+  SpawnNext();
+  ProcessStorageWork();
+}
+
+void ReceiveCallData::DoStorageWork() {
   try {
-    chat_server_log("start loading message for user");
-    auto result = storage_->Load(ExpandUserName(request_.user()));
-    *response_.mutable_messages() = {result.begin(), result.end()};
-    response_.set_status(proto::Status::kOk);
-    chat_server_log("finish loading message for user");
+    chat_log_debug("start loading message for user");
+    storage::IStorage::Cursor cursor;
+    cursor.after_ts = request_->after_ts();
+    cursor.after_uid = request_->after_uid();
+    // one extra message tells whether the slice is the last one
+    cursor.limit = request_->limit() == 0 ? 0 : request_->limit() + 1;
+    auto* messages = response_->mutable_messages();
+    const auto addressees = ExpandUserName(request_->user(), trace_id_);
+    {
+      core::trace::ScopedSpan span("storage.LoadInto", trace_id_);
+      env_->storage->LoadInto(addressees, cursor, messages);
+    }
+    const bool has_more = request_->limit() != 0 && static_cast<size_t>(messages->size()) > request_->limit();
+    if (has_more) {
+      messages->RemoveLast();
+    }
+    if (messages->empty()) {
+      response_->set_next_after_ts(request_->after_ts());
+      response_->set_next_after_uid(request_->after_uid());
+    } else {
+      const auto& last = messages->Get(messages->size() - 1);
+      response_->set_next_after_ts(last.send_ts());
+      response_->set_next_after_uid(last.message_uid());
+    }
+    response_->set_has_more(has_more);
+    response_->set_status(proto::Status::kOk);
+    chat_log_debug("finish loading message for user");
   } catch (const core::Exception& e) {
-    chat_server_log(e.what());
-    class core::BackTrace bt;
-    bt.capture();
-    chat_server_log(bt.toString());
-    response_.set_status(proto::Status::kError);
+    backend::LogStorageError(e);
+    response_->clear_messages();
+    response_->set_status(proto::Status::kError);
   }
-  SetStatus(CallStatus::kFinish);
-  responder_.Finish(response_, grpc::Status::OK, this);
 }
 
 void FromCallData::DoProcess() {
-  new FromCallData(service_, completion_queue_, storage_);
+  SpawnNext();
+  ProcessStorageWork();
+}
+
+void FromCallData::DoStorageWork() {
   try {
-    chat_server_log("start loading sended messages for user");
-    auto result = storage_->LoadSended(request_.user());
-    *response_.mutable_messages() = {result.begin(), result.end()};
-    response_.set_status(proto::Status::kOk);
-    chat_server_log("finish loading sended messages for user");
+    chat_log_debug("start loading sended messages for user");
+    {
+      core::trace::ScopedSpan span("storage.LoadSendedInto", trace_id_);
+      env_->storage->LoadSendedInto(request_->user(), response_->mutable_messages());
+    }
+    response_->set_status(proto::Status::kOk);
+    chat_log_debug("finish loading sended messages for user");
   } catch (const core::Exception& e) {
-    chat_server_log(e.what());
-    class core::BackTrace bt;
-    bt.capture();
-    chat_server_log(bt.toString());
-    response_.set_status(proto::Status::kError);
+    backend::LogStorageError(e);
+    response_->clear_messages();
+    response_->set_status(proto::Status::kError);
   }
+}
+
+void StatsCallData::DoProcess() {
+  SpawnNext();
+  FillStats(*request_, response_);
+  Respond();
+}
+
+void SubscribeCallData::DoProcess() {
+  new SubscribeCallData(env_, completion_queue_);
   SetStatus(CallStatus::kFinish);
-  responder_.Finish(response_, grpc::Status::OK, this);
+  chat_log_info("subscriber connected");
+  addressees_ = ExpandUserName(request_.user(), trace_id_);
+  if (!env_->subscribers->Add(addressees_, this)) {
+    Close(grpc::Status(grpc::StatusCode::UNAVAILABLE, "server is shutting down"));
+  }
+}
+
+void SubscribeCallData::Push(const std::shared_ptr<const proto::SubscribeResponse>& response) {
+  bool overflow = false;
+  core_with_lock(lock_) {
+    if (closed_) {
+      return;
+    }
+    if (queue_.size() >= kMaxQueuedMessages) {
+      overflow = true;
+    } else {
+      queue_.push_back(response);
+      if (!busy_) {
+        busy_ = true;
+        ref();
+        StartWriteLocked();
+      }
+    }
+  }
+  if (overflow) {
+    chat_log_warn("subscriber is too slow, closing stream");
+    Close(grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED, "too many undelivered messages, use ReceiveMessage"));
+  }
+}
+
+void SubscribeCallData::Close(const grpc::Status& status) {
+  core_with_lock(lock_) {
+    if (closed_) {
+      return;
+    }
+    closed_ = true;
+    finish_status_ = status;
+    if (busy_) {
+      finish_requested_ = true;
+    } else {
+      busy_ = true;
+      ref();
+      finished_ = true;
+      writer_.Finish(finish_status_, &write_tag_);
+    }
+  }
+}
+
+void SubscribeCallData::StartWriteLocked() { writer_.Write(*queue_.front(), &write_tag_); }
+
+void SubscribeCallData::OnWriteDone(bool ok) {
+  bool release = false;
+  core_with_lock(lock_) {
+    if (finished_) {
+      busy_ = false;
+      release = true;
+    } else {
+      queue_.pop_front();
+      if (!ok) {
+        closed_ = true;
+      }
+      if (ok && finish_requested_) {
+        finished_ = true;
+        writer_.Finish(finish_status_, &write_tag_);
+      } else if (!closed_ && !queue_.empty()) {
+        StartWriteLocked();
+      } else {
+        queue_.clear();
+        busy_ = false;
+        release = true;
+      }
+    }
+  }
+  if (release) {
+    unRef();
+  }
+}
+
+void SubscribeCallData::OnDone(bool /* ok */) {
+  chat_log_info("subscriber disconnected");
+  env_->subscribers->Remove(addressees_, this);
+  core_with_lock(lock_) { closed_ = true; }
+  unRef();
 }
 
 }  // namespace backend
\ No newline at end of file
@@ -1,101 +1,367 @@
 #pragma once
 
+#include "admission.h"
+#include "call_arena.h"
+#include "rpc_metrics.h"
+#include "subscriber_registry.h"
+#include "write_coalescer.h"
+
+#include "core/intrusive_ptr.h"
+#include "core/metrics.h"
+#include "core/noncopyable.h"
+#include "core/spinlock.h"
+#include "core/thread_pool.h"
+#include "core/trace.h"
 #include "proto/rpc_service.grpc.pb.h"
 #include "storage/storage.h"
 
 #include "grpcpp/grpcpp.h"
 
+#include <deque>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <vector>
+
 namespace backend {
 
-class ICallData {
+class CallDataPool;
+
+// State shared by all calls of a server.
+struct CallEnvironment {
+  proto::ChatRpc::AsyncService* service = nullptr;
+  storage::IStorage* storage = nullptr;
+  // nullptr runs storage work on the completion queue threads
+  core::IThreadPool* storage_pool = nullptr;
+  SubscriberRegistry* subscribers = nullptr;
+  // nullptr stores every SendMessage on its own
+  WriteCoalescer* write_coalescer = nullptr;
+  AdmissionController* admission = nullptr;
+};
+
+// Bounds of the completion queue Next call that returned the tag being handled, kept by the thread serving the
+// queue while tracing is on.
+struct DequeueSpan {
+  int64_t start_ns = 0;
+  int64_t end_ns = 0;
+};
+
+inline thread_local DequeueSpan current_dequeue;
+
+struct ICompletionTag {
+  virtual ~ICompletionTag() = default;
+
+  virtual void Complete(bool ok) = 0;
+};
+
+class ICallData : public ICompletionTag {
  public:
   enum class CallStatus { kCreate, kProcess, kFinish };
 
  public:
-  ICallData(proto::ChatRpc::AsyncService* service, grpc::ServerCompletionQueue* cq, storage::IStorage* storage);
+  ICallData(const CallEnvironment* env, grpc::ServerCompletionQueue* cq, RpcMethod method);
 
   virtual ~ICallData() = default;
 
   void Proceed();
 
+  // A failed operation ends the call, the queue is shut down or the client has gone.
+  void Complete(bool ok) override {
+    if (ok) {
+      Proceed();
+    } else {
+      DoFinish();
+    }
+  }
+
  protected:
   virtual void DoCreate() = 0;
   virtual void DoProcess() = 0;
   virtual void DoFinish() = 0;
 
+  // Storage work fills the response, DoRespond sends it and DoRespondError rejects the call instead.
+  // Calls without storage work do not override them.
+  virtual void DoStorageWork() {}
+  virtual void DoRespond() {}
+  virtual void DoRespondError(const grpc::Status& /* status */) {}
+
+  virtual const grpc::ServerContext& Context() const = 0;
+
+  // Rejects calls past their deadline or over the admission limits, then runs DoStorageWork on the storage pool when
+  // there is one and responds once it is done, otherwise runs both inline on the completion queue thread.
+  void ProcessStorageWork();
+
+  // The checks of ProcessStorageWork for calls that do their storage work elsewhere, false means the call is already
+  // rejected. An admitted call must call ReleaseAdmission with the time of its storage work when it is done.
+  bool Admit();
+
+  void ReleaseAdmission(core::Duration storage_time);
+
+  // Sends the response or the rejection of the call.
+  void Respond();
+
   inline void SetStatus(CallStatus status) noexcept { status_ = status; }
 
+ private:
+  grpc::Status CheckDeadline() const;
+
+  void RunStorageWork();
+
  protected:
-  proto::ChatRpc::AsyncService* service_;
+  const CallEnvironment* env_;
   grpc::ServerCompletionQueue* completion_queue_;
-  storage::IStorage* storage_;
+  RpcMethod method_;
   CallStatus status_;
+  const RpcMetrics* metrics_;
+  // 0 if the call is not sampled for tracing
+  uint64_t trace_id_ = 0;
+
+ private:
+  grpc::Status reject_status_;
+  core::Instant process_start_;
+  core::Instant enqueue_time_;
+  int64_t trace_start_ns_ = 0;
+  int64_t trace_enqueue_ns_ = 0;
 };
 
-class SendCallData final : public ICallData {
+// A unary call kept in the CallDataPool of its completion queue and reused for the next request of its method.
+// Derived is the final call class, it names the service method that requests its calls as kRequest.
+template <class Derived, class Request, class Response, RpcMethod kMethod>
+class PooledCallData : public ICallData {
  public:
-  SendCallData(proto::ChatRpc::AsyncService* service, grpc::ServerCompletionQueue* cq, storage::IStorage* storage);
+  // Proceeds with the DoCreate of this class, the request arrives on the thread that serves the queue once the call
+  // is constructed.
+  PooledCallData(const CallEnvironment* env, grpc::ServerCompletionQueue* cq, CallDataPool* pool)
+      : ICallData(env, cq, kMethod)
+      , pool_(pool) {
+    Reuse();
+  }
 
- private:
+  // Makes a finished call ready to accept the next request.
+  void Reuse() {
+    responder_.reset();
+    context_.emplace();
+    responder_.emplace(&*context_);
+    arena_.Reset();
+    request_ = arena_.Create<Request>();
+    response_ = arena_.Create<Response>();
+    SetStatus(CallStatus::kCreate);
+    Proceed();
+  }
+
+ protected:
   void DoCreate() override {
     SetStatus(CallStatus::kProcess);
-    service_->RequestSendMessage(&context_, &request_, &responder_, completion_queue_, completion_queue_, this);
+    (env_->service->*Derived::kRequest)(&*context_, request_, &*responder_, completion_queue_, completion_queue_,
+                                        this);
   }
 
-  void DoProcess() override;
+  void DoFinish() override;
+
+  void DoRespond() override {
+    SetStatus(CallStatus::kFinish);
+    responder_->Finish(*response_, grpc::Status::OK, this);
+  }
+
+  void DoRespondError(const grpc::Status& status) override {
+    SetStatus(CallStatus::kFinish);
+    responder_->FinishWithError(status, this);
+  }
+
+  const grpc::ServerContext& Context() const override { return *context_; }
+
+  // Starts waiting for the next request of the method, before the storage work of this one.
+  void SpawnNext();
+
+ protected:
+  CallDataPool* pool_;
 
-  void DoFinish() override { delete this; }
+  // request and response live on the arena, which is reset when the call is reused
+  Request* request_;
+  Response* response_;
 
  private:
-  grpc::ServerContext context_;
-  grpc::ServerAsyncResponseWriter<proto::SendResponse> responder_;
+  // recreated in place for every call, grpc::ServerContext can not be reset
+  std::optional<grpc::ServerContext> context_;
+  std::optional<grpc::ServerAsyncResponseWriter<Response>> responder_;
+  CallArena arena_;
+};
+
+class SendCallData final
+    : public PooledCallData<SendCallData, proto::SendRequest, proto::SendResponse, RpcMethod::kSendMessage>,
+      public WriteCoalescer::IWaiter {
+ public:
+  static constexpr auto kRequest = &proto::ChatRpc::AsyncService::RequestSendMessage;
+
+  using PooledCallData::PooledCallData;
 
-  proto::SendRequest request_;
-  proto::SendResponse response_;
+ private:
+  void DoProcess() override;
+
+  void DoStorageWork() override;
+
+  void OnStored(bool stored, const storage::IStorage::Uids& uids, core::Duration store_time) override;
+
+ private:
+  core::Instant storage_start_;
+  int64_t trace_submit_ns_ = 0;
 };
 
-class ReceiveCallData final : public ICallData {
+class SendBatchCallData final : public PooledCallData<SendBatchCallData, proto::SendBatchRequest,
+                                                      proto::SendBatchResponse, RpcMethod::kSendMessages> {
  public:
-  ReceiveCallData(proto::ChatRpc::AsyncService* service, grpc::ServerCompletionQueue* cq, storage::IStorage* storage);
+  static constexpr auto kRequest = &proto::ChatRpc::AsyncService::RequestSendMessages;
+
+  using PooledCallData::PooledCallData;
 
  private:
-  void DoCreate() override {
-    SetStatus(CallStatus::kProcess);
-    service_->RequestReceiveMessage(&context_, &request_, &responder_, completion_queue_, completion_queue_, this);
-  }
+  void DoProcess() override;
+
+  void DoStorageWork() override;
+};
+
+class ReceiveCallData final : public PooledCallData<ReceiveCallData, proto::ReceiveRequest, proto::ReceiveResponse,
+                                                    RpcMethod::kReceiveMessage> {
+ public:
+  static constexpr auto kRequest = &proto::ChatRpc::AsyncService::RequestReceiveMessage;
 
+  using PooledCallData::PooledCallData;
+
+ private:
   void DoProcess() override;
 
-  void DoFinish() override { delete this; }
+  void DoStorageWork() override;
+};
+
+class FromCallData final
+    : public PooledCallData<FromCallData, proto::FromRequest, proto::FromResponse, RpcMethod::kSendedMessages> {
+ public:
+  static constexpr auto kRequest = &proto::ChatRpc::AsyncService::RequestSendedMessages;
+
+  using PooledCallData::PooledCallData;
 
  private:
-  grpc::ServerContext context_;
-  grpc::ServerAsyncResponseWriter<proto::ReceiveResponse> responder_;
+  void DoProcess() override;
+
+  void DoStorageWork() override;
+};
+
+class StatsCallData final
+    : public PooledCallData<StatsCallData, proto::StatsRequest, proto::StatsResponse, RpcMethod::kGetStats> {
+ public:
+  static constexpr auto kRequest = &proto::ChatRpc::AsyncService::RequestGetStats;
 
-  proto::ReceiveRequest request_;
-  proto::ReceiveResponse response_;
+  using PooledCallData::PooledCallData;
+
+ private:
+  void DoProcess() override;
 };
 
-class FromCallData final : public ICallData {
+class SubscribeCallData final : public ICallData, public ISubscriber {
  public:
-  FromCallData(proto::ChatRpc::AsyncService* service, grpc::ServerCompletionQueue* cq, storage::IStorage* storage);
+  SubscribeCallData(const CallEnvironment* env, grpc::ServerCompletionQueue* cq);
+
+  void Push(const std::shared_ptr<const proto::SubscribeResponse>& response) override;
+
+  void Close(const grpc::Status& status = grpc::Status::OK) override;
+
+ private:
+  class Tag final : public ICompletionTag {
+   public:
+    inline Tag(SubscribeCallData* owner, void (SubscribeCallData::*handler)(bool)) noexcept
+        : owner_(owner)
+        , handler_(handler) {}
+
+    void Complete(bool ok) override { (owner_->*handler_)(ok); }
+
+   private:
+    SubscribeCallData* owner_;
+    void (SubscribeCallData::*handler_)(bool);
+  };
 
  private:
   void DoCreate() override {
     SetStatus(CallStatus::kProcess);
-    service_->RequestSendedMessages(&context_, &request_, &responder_, completion_queue_, completion_queue_, this);
+    context_.AsyncNotifyWhenDone(&done_tag_);
+    env_->service->RequestSubscribe(&context_, &request_, &writer_, completion_queue_, completion_queue_, this);
   }
 
   void DoProcess() override;
 
-  void DoFinish() override { delete this; }
+  void DoFinish() override {}
+
+  const grpc::ServerContext& Context() const override { return context_; }
+
+  void OnWriteDone(bool ok);
+  void OnDone(bool ok);
+
+  void StartWriteLocked();
 
  private:
+  static constexpr size_t kMaxQueuedMessages = 1024;
+
+  std::vector<std::string> addressees_;
+
   grpc::ServerContext context_;
-  grpc::ServerAsyncResponseWriter<proto::FromResponse> responder_;
+  grpc::ServerAsyncWriter<proto::SubscribeResponse> writer_;
+  proto::SubscribeRequest request_;
+
+  Tag write_tag_;
+  Tag done_tag_;
 
-  proto::FromRequest request_;
-  proto::FromResponse response_;
+  core::AdaptiveLock lock_;
+  std::deque<std::shared_ptr<const proto::SubscribeResponse>> queue_;
+  grpc::Status finish_status_;
+  bool busy_ = false;
+  bool closed_ = false;
+  bool finish_requested_ = false;
+  bool finished_ = false;
 };
 
+// Free lists of finished unary calls of one completion queue. Only the thread serving the queue touches the lists,
+// reuses and allocations of all the pools are counted by chat_call_pool_hits_total and chat_call_pool_misses_total.
+class CallDataPool : public core::NonCopyable {
+ public:
+  CallDataPool();
+
+  ~CallDataPool();
+
+  // Starts waiting for the next request of T with a released call, the arguments are used only for a new one.
+  template <class T, class... Args>
+  void Spawn(Args&&... args) {
+    auto& list = std::get<std::vector<T*>>(free_);
+    if (list.empty()) {
+      misses_.inc();
+      new T(std::forward<Args>(args)..., this);
+    } else {
+      hits_.inc();
+      T* call = list.back();
+      list.pop_back();
+      call->Reuse();
+    }
+  }
+
+  template <class T>
+  void Release(T* call) {
+    std::get<std::vector<T*>>(free_).push_back(call);
+  }
+
+ private:
+  std::tuple<std::vector<SendCallData*>, std::vector<SendBatchCallData*>, std::vector<ReceiveCallData*>,
+             std::vector<FromCallData*>, std::vector<StatsCallData*>>
+      free_;
+  core::metrics::Counter& hits_;
+  core::metrics::Counter& misses_;
+};
+
+template <class Derived, class Request, class Response, RpcMethod kMethod>
+void PooledCallData<Derived, Request, Response, kMethod>::DoFinish() {
+  pool_->Release(static_cast<Derived*>(this));
+}
+
+template <class Derived, class Request, class Response, RpcMethod kMethod>
+void PooledCallData<Derived, Request, Response, kMethod>::SpawnNext() {
+  pool_->Spawn<Derived>(env_, completion_queue_);
+}
+
 }  // namespace backend
\ No newline at end of file
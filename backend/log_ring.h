@@ -0,0 +1,108 @@
+#pragma once
+
+#include "core/atomic.h"
+#include "core/noncopyable.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+namespace backend {
+
+// Header of a record in a LogRing, the encoded arguments follow it.
+struct LogRecord {
+  using Formatter = void (*)(const char* format, const uint8_t* args, std::string* out);
+
+  static constexpr uint32_t kPadding = ~uint32_t(0);
+
+  // of the whole record including the arguments and the alignment
+  uint32_t size;
+  // LogLevel, kPadding marks the unused tail of the ring before a wrap
+  uint32_t level;
+  int64_t time_ns;
+  const char* format;
+  Formatter formatter;
+};
+
+// Byte queue of log records with a single producer, the thread owning the ring, and a single consumer, the log
+// writer. Neither side takes a lock or allocates.
+class LogRing : public core::NonCopyable {
+ public:
+  static constexpr size_t kCapacity = size_t(256) << 10;
+
+ public:
+  explicit LogRing(size_t thread_id)
+      : thread_id_(thread_id)
+      , data_(new uint8_t[kCapacity]) {}
+
+  // Space for a record of the given size or nullptr if it does not fit, the record is visible after Commit.
+  inline uint8_t* Reserve(size_t size) noexcept {
+    size = (size + alignof(LogRecord) - 1) & ~(alignof(LogRecord) - 1);
+    auto head = static_cast<size_t>(head_);
+    const size_t till_end = kCapacity - (head & (kCapacity - 1));
+    const size_t needed = size <= till_end ? size : till_end + size;
+    if (head + needed - cached_tail_ > kCapacity) {
+      cached_tail_ = static_cast<size_t>(core::atomics::Load(tail_));
+      if (head + needed - cached_tail_ > kCapacity) {
+        return nullptr;
+      }
+    }
+    if (size > till_end) {
+      auto* padding = reinterpret_cast<LogRecord*>(data_.get() + (head & (kCapacity - 1)));
+      padding->size = static_cast<uint32_t>(till_end);
+      padding->level = LogRecord::kPadding;
+      head += till_end;
+    }
+    pending_head_ = head + size;
+    auto* record = data_.get() + (head & (kCapacity - 1));
+    reinterpret_cast<LogRecord*>(record)->size = static_cast<uint32_t>(size);
+    return record;
+  }
+
+  inline void Commit() noexcept { core::atomics::Store(head_, static_cast<core::AtomicType>(pending_head_)); }
+
+  // Only the producer changes the counter, the consumer reads it.
+  inline void CountDropped() noexcept {
+    core::atomics::Store(dropped_, core::atomics::Load(dropped_) + 1);
+  }
+
+  // Consumer side: calls f for every committed record and frees their space.
+  template <class F>
+  void Drain(F&& f) {
+    auto tail = static_cast<size_t>(core::atomics::Load(tail_));
+    const auto head = static_cast<size_t>(core::atomics::Load(head_));
+    while (tail != head) {
+      const auto& record = *reinterpret_cast<const LogRecord*>(data_.get() + (tail & (kCapacity - 1)));
+      if (record.level != LogRecord::kPadding) {
+        f(record);
+      }
+      tail += record.size;
+    }
+    core::atomics::Store(tail_, static_cast<core::AtomicType>(tail));
+  }
+
+  inline size_t ThreadId() const noexcept { return thread_id_; }
+
+  inline auto Dropped() const noexcept { return core::atomics::Load(dropped_); }
+
+  // The owning thread has exited, the ring is freed once it is drained.
+  inline void Orphan() noexcept { core::atomics::Store(orphaned_, 1); }
+  inline bool Orphaned() const noexcept { return core::atomics::Load(orphaned_) != 0; }
+
+ private:
+  const size_t thread_id_;
+  std::unique_ptr<uint8_t[]> data_;
+
+  // producer
+  alignas(64) core::Atomic head_ = 0;
+  size_t pending_head_ = 0;
+  size_t cached_tail_ = 0;
+  core::Atomic dropped_ = 0;
+
+  // consumer
+  alignas(64) core::Atomic tail_ = 0;
+  core::Atomic orphaned_ = 0;
+};
+
+}  // namespace backend
@@ -1,8 +1,180 @@
 #include "logging.h"
 
+#include "spdlog/details/os.h"
 #include "spdlog/sinks/rotating_file_sink.h"
+#include "spdlog/spdlog.h"
 
+#include "core/backtrace_cache.h"
+#include "core/event.h"
 #include "core/exception.h"
+#include "core/guard.h"
+#include "core/mutex.h"
+#include "core/singleton.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr spdlog::level::level_enum kSpdlogLevels[] = {spdlog::level::debug, spdlog::level::info,
+                                                       spdlog::level::warn, spdlog::level::err};
+
+// Drains the rings of all threads into the spdlog sinks. Records of one pass are ordered by time, the sinks get the
+// thread id of the producer rather than the one of the writer.
+class LogWriter : public core::NonCopyable {
+  struct Entry {
+    int64_t time_ns;
+    uint32_t level;
+    size_t thread_id;
+    std::string text;
+  };
+
+ public:
+  ~LogWriter() { Stop(); }
+
+  backend::LogRing* Register() noexcept {
+    auto* ring = new (std::nothrow) backend::LogRing(spdlog::details::os::thread_id());
+    if (ring != nullptr) {
+      core_with_lock(lock_) { rings_.push_back(ring); }
+    }
+    return ring;
+  }
+
+  void Start(std::shared_ptr<spdlog::logger> logger) {
+    logger_ = std::move(logger);
+    stop_.reset();
+    thread_ = std::thread([this] { Loop(); });
+    core::atomics::Store(backend::detail::log_enabled, 1);
+  }
+
+  void Stop() {
+    if (!thread_.joinable()) {
+      return;
+    }
+    core::atomics::Store(backend::detail::log_enabled, 0);
+    stop_.signal();
+    thread_.join();
+    Drain();
+    logger_->flush();
+  }
+
+ private:
+  void Loop() {
+    static const core::Duration kDrainInterval = absl::Milliseconds(10);
+
+    while (!stop_.wait(kDrainInterval)) {
+      Drain();
+    }
+  }
+
+  void Drain() {
+    core::AtomicType dropped = dropped_by_exited_;
+    core_with_lock(lock_) {
+      for (auto it = rings_.begin(); it != rings_.end();) {
+        auto* ring = *it;
+        // a ring orphaned before the drain has no records committed after it
+        const bool orphaned = ring->Orphaned();
+        ring->Drain([&](const backend::LogRecord& record) { entries_.push_back(Format(record, ring->ThreadId())); });
+        dropped += ring->Dropped();
+        if (orphaned) {
+          dropped_by_exited_ += ring->Dropped();
+          delete ring;
+          it = rings_.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+
+    std::stable_sort(entries_.begin(), entries_.end(),
+                     [](const Entry& lhs, const Entry& rhs) { return lhs.time_ns < rhs.time_ns; });
+    for (const auto& entry : entries_) {
+      Write(entry);
+    }
+    entries_.clear();
+
+    if (dropped > reported_dropped_) {
+      Write({backend::detail::LogClockNow(), static_cast<uint32_t>(backend::LogLevel::kWarn),
+             spdlog::details::os::thread_id(),
+             std::to_string(dropped - reported_dropped_) + " log records dropped, the log ring was full"});
+      reported_dropped_ = dropped;
+    }
+  }
+
+  static Entry Format(const backend::LogRecord& record, size_t thread_id) {
+    Entry entry{record.time_ns, record.level, thread_id, {}};
+    try {
+      record.formatter(record.format, reinterpret_cast<const uint8_t*>(&record + 1), &entry.text);
+    } catch (const std::exception& e) {
+      entry.text = std::string(record.format) + " [" + e.what() + "]";
+    }
+    return entry;
+  }
+
+  void Write(const Entry& entry) {
+    const auto time = spdlog::log_clock::time_point(
+        std::chrono::duration_cast<spdlog::log_clock::duration>(std::chrono::nanoseconds(entry.time_ns)));
+    spdlog::details::log_msg msg(time, spdlog::source_loc{}, logger_->name(), kSpdlogLevels[entry.level],
+                                 entry.text);
+    msg.thread_id = entry.thread_id;
+    for (const auto& sink : logger_->sinks()) {
+      if (sink->should_log(msg.level)) {
+        sink->log(msg);
+      }
+    }
+  }
+
+ private:
+  core::Mutex lock_;
+  // a ring is freed by the drain after its thread has exited
+  std::vector<backend::LogRing*> rings_;
+  core::AtomicType dropped_by_exited_ = 0;
+  core::AtomicType reported_dropped_ = 0;
+
+  std::shared_ptr<spdlog::logger> logger_;
+  core::ManualEvent stop_;
+  std::thread thread_;
+  std::vector<Entry> entries_;
+};
+
+}  // namespace
+
+backend::LogBackTrace backend::MakeLogBackTrace(const class core::BackTrace& bt) {
+  return {core::BackTraceCache::instance().add(bt)};
+}
+
+std::string backend::detail::SymbolizeLogBackTrace(uint64_t hash) {
+  auto symbolized = core::BackTraceCache::instance().symbolize(hash);
+  if (symbolized.empty()) {
+    return "backtrace is not kept, too many distinct stacks";
+  }
+  return symbolized;
+}
+
+// The stacks of failures that were thrown without one are captured here.
+void backend::LogStorageError(const core::Exception& e) {
+  static constexpr size_t kErrorsPerSecond = 10;
+  static LogRateLimiter limiter(kErrorsPerSecond);
+
+  if (!limiter.Allow()) {
+    return;
+  }
+  class core::BackTrace bt;
+  const auto* thrown = e.backTrace();
+  if (thrown == nullptr) {
+    bt.capture();
+    thrown = &bt;
+  }
+  const auto stack = MakeLogBackTrace(*thrown);
+  if (const auto suppressed = limiter.TakeSuppressed(); suppressed != 0) {
+    chat_log_error("{} ({} similar errors were not logged)\n{}", e.what(), suppressed, stack);
+  } else {
+    chat_log_error("{}\n{}", e.what(), stack);
+  }
+}
+
+backend::LogRing* backend::detail::RegisterLogRing() noexcept { return core::Singleton<LogWriter>()->Register(); }
 
 void backend::InitializeLogger(const LoggerConfig& config) {
   try {
@@ -10,7 +182,10 @@ void backend::InitializeLogger(const LoggerConfig& config) {
         spdlog::rotating_logger_mt("chat_logger", config.log_file, config.max_file_size, config.max_file_count);
     logger->set_pattern("[%n] (%H:%M:%S:%e %z) {%t} %l: %v");
     spdlog::flush_every(std::chrono::seconds(5));
+    core::Singleton<LogWriter>()->Start(std::move(logger));
   } catch (const spdlog::spdlog_ex& ex) {
     core_throw core::Exception() << ex.what();
   }
-}
\ No newline at end of file
+}
+
+void backend::ShutdownLogger() { core::Singleton<LogWriter>()->Stop(); }
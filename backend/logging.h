@@ -1,19 +1,256 @@
 #pragma once
 
-#include "spdlog/spdlog.h"
+#include "log_ring.h"
 
+#include "core/backtrace.h"
+#include "core/exception.h"
+
+#include "spdlog/fmt/fmt.h"
+
+#include <ctime>
+#include <iterator>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+// Records below the level are compiled out: 0 debug, 1 info, 2 warn, 3 error.
+#ifndef CHAT_LOG_LEVEL
+#define CHAT_LOG_LEVEL 1
+#endif
+
+// The format string must be a literal, it is formatted with the arguments by the log writer later. Arithmetic,
+// enum and string arguments are supported, strings are copied.
+#if CHAT_LOG_LEVEL <= 0
+#define chat_log_debug(...) ::backend::Log(::backend::LogLevel::kDebug, __VA_ARGS__)
+#else
+#define chat_log_debug(...) \
+  do {                      \
+  } while (false)
+#endif
+
+#if CHAT_LOG_LEVEL <= 1
+#define chat_log_info(...) ::backend::Log(::backend::LogLevel::kInfo, __VA_ARGS__)
+#else
+#define chat_log_info(...) \
+  do {                     \
+  } while (false)
+#endif
+
+#if CHAT_LOG_LEVEL <= 2
+#define chat_log_warn(...) ::backend::Log(::backend::LogLevel::kWarn, __VA_ARGS__)
+#else
+#define chat_log_warn(...) \
+  do {                     \
+  } while (false)
+#endif
 
-#define chat_server_log(x) spdlog::get("chat_logger")->info((x))
+#define chat_log_error(...) ::backend::Log(::backend::LogLevel::kError, __VA_ARGS__)
 
 namespace backend {
 
+enum class LogLevel : uint32_t { kDebug, kInfo, kWarn, kError };
+
 struct LoggerConfig {
   std::string log_file;
   size_t max_file_size;
   size_t max_file_count;
 };
 
+// A backtrace argument of a log record. The caller only unwinds, the log writer symbolizes the stack once per
+// distinct stack and reuses the text for the next records.
+struct LogBackTrace {
+  uint64_t hash;
+};
+
+LogBackTrace MakeLogBackTrace(const class core::BackTrace& bt);
+
+// Opens the rotating log file and starts the writer, which drains the thread rings into it. Records logged before
+// are dropped.
 void InitializeLogger(const LoggerConfig& config);
 
-}  // namespace backend
\ No newline at end of file
+// Writes the pending records and stops the writer, also called at exit.
+void ShutdownLogger();
+
+namespace detail {
+
+// set while the writer runs
+inline core::Atomic log_enabled = 0;
+
+// Registers a ring of the calling thread with the writer, nullptr if it can not be allocated.
+LogRing* RegisterLogRing() noexcept;
+
+struct LogRingHandle {
+  ~LogRingHandle() {
+    if (ring != nullptr) {
+      ring->Orphan();
+    }
+  }
+
+  LogRing* ring = nullptr;
+};
+
+inline thread_local LogRingHandle log_ring;
+
+inline LogRing* CurrentLogRing() noexcept {
+  auto& handle = log_ring;
+  if (handle.ring == nullptr) {
+    handle.ring = RegisterLogRing();
+  }
+  return handle.ring;
+}
+
+// The coarse clock is read in a few nanoseconds, its resolution of a scheduler tick is enough for log lines.
+inline int64_t LogClockNow() noexcept {
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+template <class T, class = void>
+struct LogArg {
+  static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "unsupported log argument type");
+
+  using Decoded = std::conditional_t<std::is_enum_v<T>, std::underlying_type<T>, std::common_type<T>>;
+
+  static inline size_t Size(const T&) noexcept { return sizeof(T); }
+
+  static inline uint8_t* Encode(uint8_t* p, const T& value) noexcept {
+    memcpy(p, &value, sizeof(T));
+    return p + sizeof(T);
+  }
+
+  static inline typename Decoded::type Decode(const uint8_t*& p) noexcept {
+    T value;
+    memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return static_cast<typename Decoded::type>(value);
+  }
+};
+
+template <class T>
+struct LogArg<T, std::enable_if_t<std::is_convertible_v<const T&, std::string_view>>> {
+  static inline std::string_view View(const T& value) noexcept {
+    if constexpr (std::is_pointer_v<T>) {
+      return value == nullptr ? std::string_view() : std::string_view(value);
+    } else {
+      return value;
+    }
+  }
+
+  static inline size_t Size(const T& value) noexcept { return sizeof(uint32_t) + View(value).size(); }
+
+  static inline uint8_t* Encode(uint8_t* p, const T& value) noexcept {
+    const auto view = View(value);
+    const auto size = static_cast<uint32_t>(view.size());
+    memcpy(p, &size, sizeof(size));
+    memcpy(p + sizeof(size), view.data(), size);
+    return p + sizeof(size) + size;
+  }
+
+  static inline std::string_view Decode(const uint8_t*& p) noexcept {
+    uint32_t size;
+    memcpy(&size, p, sizeof(size));
+    std::string_view result(reinterpret_cast<const char*>(p + sizeof(size)), size);
+    p += sizeof(size) + size;
+    return result;
+  }
+};
+
+std::string SymbolizeLogBackTrace(uint64_t hash);
+
+template <>
+struct LogArg<LogBackTrace> {
+  static inline size_t Size(const LogBackTrace&) noexcept { return sizeof(uint64_t); }
+
+  static inline uint8_t* Encode(uint8_t* p, const LogBackTrace& value) noexcept {
+    memcpy(p, &value.hash, sizeof(uint64_t));
+    return p + sizeof(uint64_t);
+  }
+
+  static inline std::string Decode(const uint8_t*& p) {
+    uint64_t hash;
+    memcpy(&hash, p, sizeof(hash));
+    p += sizeof(hash);
+    return SymbolizeLogBackTrace(hash);
+  }
+};
+
+// string literals decay to const char*
+template <class T>
+using LogArgOf = LogArg<std::decay_t<const T>>;
+
+template <class... Args>
+void FormatLogRecord(const char* format, const uint8_t* args, std::string* out) {
+  // braced initialization decodes the arguments left to right
+  const std::tuple<decltype(LogArgOf<Args>::Decode(args))...> values{
+      LogArgOf<Args>::Decode(args)...};
+  std::apply(
+      [&](const auto&... v) {
+        fmt::vformat_to(std::back_inserter(*out), fmt::string_view(format), fmt::make_format_args(v...));
+      },
+      values);
+}
+
+}  // namespace detail
+
+// Copies the arguments into the ring of the calling thread, a record that does not fit is dropped and counted.
+template <class... Args>
+inline void Log(LogLevel level, const char* format, const Args&... args) noexcept {
+  if (core::atomics::Load(detail::log_enabled) == 0) {
+    return;
+  }
+  auto* ring = detail::CurrentLogRing();
+  if (ring == nullptr) {
+    return;
+  }
+  const size_t size = sizeof(LogRecord) + (detail::LogArgOf<Args>::Size(args) + ... + 0);
+  auto* data = ring->Reserve(size);
+  if (data == nullptr) {
+    ring->CountDropped();
+    return;
+  }
+  auto* record = reinterpret_cast<LogRecord*>(data);
+  record->level = static_cast<uint32_t>(level);
+  record->time_ns = detail::LogClockNow();
+  record->format = format;
+  record->formatter = &detail::FormatLogRecord<Args...>;
+  [[maybe_unused]] uint8_t* p = data + sizeof(LogRecord);
+  ((p = detail::LogArgOf<Args>::Encode(p, args)), ...);
+  ring->Commit();
+}
+
+// Lets through at most `per_second` events a second and counts the rest, for records that repeat in error
+// storms.
+class LogRateLimiter : public core::NonCopyable {
+ public:
+  explicit inline LogRateLimiter(size_t per_second) noexcept
+      : per_second_(static_cast<core::AtomicType>(per_second)) {}
+
+  inline bool Allow() noexcept {
+    const auto second = static_cast<core::AtomicType>(detail::LogClockNow() / 1000000000);
+    const auto window = core::atomics::Load(window_);
+    if (window != second && core::atomics::Cas(&window_, second, window)) {
+      core::atomics::Store(allowed_, 0);
+    }
+    if (core::atomics::Increment(allowed_) <= per_second_) {
+      return true;
+    }
+    core::atomics::Increment(suppressed_);
+    return false;
+  }
+
+  // Events suppressed since the last call.
+  inline uint64_t TakeSuppressed() noexcept { return static_cast<uint64_t>(core::atomics::Swap(&suppressed_, 0)); }
+
+ private:
+  const core::AtomicType per_second_;
+  core::Atomic window_ = 0;
+  core::Atomic allowed_ = 0;
+  core::Atomic suppressed_ = 0;
+};
+
+// A storage outage fails every call at once, only a few errors a second are logged with their stacks.
+void LogStorageError(const core::Exception& e);
+
+}  // namespace backend
@@ -0,0 +1,94 @@
+#include "rpc_metrics.h"
+
+#include "core/lock_profiler.h"
+#include "core/trace.h"
+
+#include <vector>
+
+namespace backend {
+
+const char* MethodName(RpcMethod method) noexcept {
+  switch (method) {
+    case RpcMethod::kSendMessage:
+      return "SendMessage";
+    case RpcMethod::kSendMessages:
+      return "SendMessages";
+    case RpcMethod::kReceiveMessage:
+      return "ReceiveMessage";
+    case RpcMethod::kSendedMessages:
+      return "SendedMessages";
+    case RpcMethod::kSubscribe:
+      return "Subscribe";
+    case RpcMethod::kGetStats:
+      return "GetStats";
+    default:
+      return "unknown";
+  }
+}
+
+static std::vector<RpcMetrics> CreateMethodMetrics() {
+  auto& registry = core::metrics::Registry::instance();
+  std::vector<RpcMetrics> result;
+  for (size_t i = 0; i < static_cast<size_t>(RpcMethod::kCount); ++i) {
+    const std::string method = std::string("method=\"") + MethodName(static_cast<RpcMethod>(i)) + "\"";
+    const auto latency = [&](const char* stage) -> core::metrics::Histogram& {
+      return registry.histogram("chat_rpc_latency_seconds", method + ",stage=\"" + stage + "\"");
+    };
+    result.push_back({registry.counter("chat_rpc_calls_total", method),
+                      registry.counter("chat_rpc_rejected_total", method), latency("queue"), latency("storage"),
+                      latency("respond"), latency("total")});
+  }
+  return result;
+}
+
+const RpcMetrics& MethodMetrics(RpcMethod method) {
+  static const auto metrics = CreateMethodMetrics();
+  return metrics[static_cast<size_t>(method)];
+}
+
+static void FillValue(const core::metrics::MetricSample& sample, proto::MetricValue* value) {
+  value->set_name(sample.name);
+  value->set_labels(sample.labels);
+  value->set_value(sample.value);
+}
+
+static double Microseconds(uint64_t ns) { return static_cast<double>(ns) / 1000; }
+
+void FillStats(const proto::StatsRequest& request, proto::StatsResponse* response) {
+  const auto samples = core::metrics::Registry::instance().collect();
+  for (const auto& sample : samples) {
+    switch (sample.kind) {
+      case core::metrics::MetricSample::Kind::kCounter:
+        FillValue(sample, response->add_counters());
+        break;
+      case core::metrics::MetricSample::Kind::kGauge:
+        FillValue(sample, response->add_gauges());
+        break;
+      case core::metrics::MetricSample::Kind::kHistogram: {
+        const auto& histogram = sample.histogram;
+        auto* latency = response->add_latencies();
+        latency->set_name(sample.name);
+        latency->set_labels(sample.labels);
+        latency->set_count(histogram.count);
+        latency->set_sum_us(Microseconds(histogram.sum));
+        latency->set_p50_us(Microseconds(histogram.valueAtQuantile(0.5)));
+        latency->set_p90_us(Microseconds(histogram.valueAtQuantile(0.9)));
+        latency->set_p99_us(Microseconds(histogram.valueAtQuantile(0.99)));
+        latency->set_p999_us(Microseconds(histogram.valueAtQuantile(0.999)));
+        latency->set_max_us(Microseconds(histogram.max));
+        break;
+      }
+    }
+  }
+  if (request.prometheus()) {
+    response->set_prometheus(core::metrics::DumpPrometheus(samples));
+  }
+  if (request.chrome_trace()) {
+    response->set_chrome_trace(core::trace::DumpChromeTrace(core::trace::Collect()));
+  }
+  if (request.lock_profile()) {
+    response->set_lock_profile(core::lock_profiler::Format(core::lock_profiler::Collect()));
+  }
+}
+
+}  // namespace backend
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "admission.h"
+
+#include "core/metrics.h"
+#include "proto/stats.pb.h"
+
+namespace backend {
+
+const char* MethodName(RpcMethod method) noexcept;
+
+// Metrics of one method, the latency stages follow a call through ICallData.
+struct RpcMetrics {
+  core::metrics::Counter& calls;
+  // calls refused by the deadline check or admission control
+  core::metrics::Counter& rejected;
+  // waiting for a storage pool thread
+  core::metrics::Histogram& queue;
+  core::metrics::Histogram& storage;
+  // handing the response to grpc, which serializes it
+  core::metrics::Histogram& respond;
+  // from the arrival of the request until grpc reports the response sent
+  core::metrics::Histogram& total;
+};
+
+const RpcMetrics& MethodMetrics(RpcMethod method);
+
+// Metrics of the process, and the trace spans if the request asks for them.
+void FillStats(const proto::StatsRequest& request, proto::StatsResponse* response);
+
+}  // namespace backend
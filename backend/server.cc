@@ -1,6 +1,14 @@
 #include "server.h"
 #include "grpc_call_data.h"
 
+#include "core/cpu_set.h"
+#include "core/thread.h"
+
+#include "absl/strings/str_join.h"
+
+#include <algorithm>
+#include <functional>
+
 namespace backend {
 
 void RpcServer::Start(const std::string& server_address) {
@@ -12,19 +20,32 @@ void RpcServer::Start(const std::string& server_address) {
 
   for (size_t i = 0; i < threads_.capacity(); ++i) {
     completion_queues_.emplace_back(builder.AddCompletionQueue());
+    call_data_pools_.emplace_back(std::make_unique<CallDataPool>());
   }
 
   core::atomics::Store(is_running_, 1);
   server_ = builder.BuildAndStart();
 
   for (size_t i = 0; i < threads_.capacity(); ++i) {
-    threads_.emplace_back(&RpcServer::ThreadWorker, this, completion_queues_[i].get());
+    threads_.emplace_back(&RpcServer::ThreadWorker, this, completion_queues_[i].get(), call_data_pools_[i].get(),
+                          std::cref(worker_cpus_[i]));
   }
 }
 
 void RpcServer::Stop() {
   core::atomics::Store(is_running_, 0);
+  subscribers_.Stop();
   server_->Shutdown();
+  // pending storage work still finishes its calls, so the queues must outlive it
+  if (write_coalescer_) {
+    write_coalescer_->Stop();
+  }
+  if (storage_pool_) {
+    storage_pool_->stop();
+  }
+  if (admission_) {
+    chat_log_info("calls rejected by admission control: {}", admission_->Rejected());
+  }
   for (const auto& cq : completion_queues_) {
     cq->Shutdown();
   }
@@ -36,18 +57,58 @@ void RpcServer::Stop() {
 
 void RpcServer::WaitForStop() { stop_event_.wait(); }
 
-void RpcServer::ThreadWorker(grpc::ServerCompletionQueue* completion_queue) {
-  new SendCallData(&service_, completion_queue, storage_.get());
-  new ReceiveCallData(&service_, completion_queue, storage_.get());
-  new FromCallData(&service_, completion_queue, storage_.get());
+std::vector<size_t> RpcServer::WorkerCpus(const Config& config, size_t worker) {
+  if (!config.cpu_set.empty()) {
+    return {config.cpu_set[worker % config.cpu_set.size()]};
+  }
+  if (config.numa_policy == NumaPolicy::kSpread) {
+    const auto nodes = core::NumaNodes();
+    return core::NumaNodeCpus(nodes[worker % nodes.size()]);
+  }
+  return {};
+}
+
+std::vector<size_t> RpcServer::StorageCpus(const Config& config,
+                                           const std::vector<std::vector<size_t>>& worker_cpus) {
+  // the whole set, even the cpus no completion queue thread got
+  if (!config.cpu_set.empty()) {
+    return config.cpu_set;
+  }
+  std::vector<size_t> cpus;
+  for (const auto& worker : worker_cpus) {
+    cpus.insert(cpus.end(), worker.begin(), worker.end());
+  }
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  return cpus;
+}
+
+void RpcServer::ThreadWorker(grpc::ServerCompletionQueue* completion_queue, CallDataPool* pool,
+                             const std::vector<size_t>& cpus) {
+  if (!cpus.empty() && !core::Thread::setCurrentThreadAffinity(cpus)) {
+    chat_log_warn("can not pin completion queue thread to cpus {}", absl::StrJoin(cpus, ","));
+  }
+
+  for (size_t i = 0; i < prepost_per_method_; ++i) {
+    pool->Spawn<SendCallData>(&env_, completion_queue);
+    pool->Spawn<SendBatchCallData>(&env_, completion_queue);
+    pool->Spawn<ReceiveCallData>(&env_, completion_queue);
+    pool->Spawn<FromCallData>(&env_, completion_queue);
+    pool->Spawn<StatsCallData>(&env_, completion_queue);
+    new SubscribeCallData(&env_, completion_queue);
+  }
 
   void* tag;
   bool ok;
 
-  while (completion_queue->Next(&tag, &ok)) {
-    if (ok) {
-      static_cast<ICallData*>(tag)->Proceed();
+  while (true) {
+    const bool tracing = core::trace::Enabled();
+    const auto next_start = tracing ? core::trace::Now() : 0;
+    if (!completion_queue->Next(&tag, &ok)) {
+      break;
     }
+    current_dequeue = {next_start, tracing ? core::trace::Now() : 0};
+    static_cast<ICompletionTag*>(tag)->Complete(ok);
   }
 }
 
@@ -1,14 +1,22 @@
 #pragma once
 
+#include "admission.h"
+#include "backend_config.h"
+#include "grpc_call_data.h"
 #include "logging.h"
+#include "subscriber_registry.h"
+#include "write_coalescer.h"
 
 #include "core/atomic.h"
 #include "core/event.h"
+#include "core/thread_pool.h"
+#include "core/trace.h"
 #include "proto/rpc_service.grpc.pb.h"
 #include "storage/storage.h"
 
 #include "grpcpp/grpcpp.h"
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <thread>
@@ -18,15 +26,41 @@ namespace backend {
 
 class RpcServer {
  public:
-  RpcServer(size_t threads_num, std::unique_ptr<storage::IStorage> storage)
-      : storage_(std::move(storage)) {
-    chat_server_log("starting rpc service");
-    completion_queues_.reserve(threads_num);
-    threads_.reserve(threads_num);
+  RpcServer(const Config& config, std::unique_ptr<storage::IStorage> storage)
+      : prepost_per_method_(std::max<size_t>(config.prepost_per_method, 1))
+      , storage_(std::move(storage)) {
+    chat_log_info("starting rpc service");
+    core::trace::SetSampling(config.trace_sample_one_in);
+    completion_queues_.reserve(config.threads_num);
+    call_data_pools_.reserve(config.threads_num);
+    threads_.reserve(config.threads_num);
+    worker_cpus_.reserve(config.threads_num);
+    for (size_t i = 0; i < config.threads_num; ++i) {
+      worker_cpus_.push_back(WorkerCpus(config, i));
+    }
+    if (config.storage_threads_num > 0) {
+      storage_pool_ = std::make_unique<core::ThreadPool>(
+          core::ThreadPoolParams().setThreadNamePrefix("storage").setAffinity(StorageCpus(config, worker_cpus_)));
+      storage_pool_->start(config.storage_threads_num);
+    }
+    if (config.write_batch_window_us > 0) {
+      write_coalescer_ = std::make_unique<WriteCoalescer>(
+          storage_.get(), absl::Microseconds(config.write_batch_window_us), config.write_batch_size);
+    }
+    if (config.admission.max_in_flight_per_method > 0 || config.admission.adaptive) {
+      admission_ = std::make_unique<AdmissionController>(config.admission);
+    }
+
+    env_.service = &service_;
+    env_.storage = storage_.get();
+    env_.storage_pool = storage_pool_.get();
+    env_.subscribers = &subscribers_;
+    env_.write_coalescer = write_coalescer_.get();
+    env_.admission = admission_.get();
   }
 
   ~RpcServer() {
-    chat_server_log("stopping rpc service");
+    chat_log_info("stopping rpc service");
     if (core::atomics::Load(is_running_)) {
       Stop();
     }
@@ -39,18 +73,34 @@ class RpcServer {
   void WaitForStop();
 
  private:
-  void ThreadWorker(grpc::ServerCompletionQueue* completion_queue);
+  // CPUs the completion queue thread is pinned to, empty if it is not pinned.
+  static std::vector<size_t> WorkerCpus(const Config& config, size_t worker);
+
+  // CPUs the storage threads run on, the ones of all the completion queue threads, empty if they are not pinned.
+  static std::vector<size_t> StorageCpus(const Config& config, const std::vector<std::vector<size_t>>& worker_cpus);
+
+  void ThreadWorker(grpc::ServerCompletionQueue* completion_queue, CallDataPool* pool,
+                    const std::vector<size_t>& cpus);
 
  private:
   core::Atomic is_running_ = 0;
 
+  size_t prepost_per_method_;
+
   core::ManualEvent stop_event_;
   proto::ChatRpc::AsyncService service_;
 
   std::unique_ptr<grpc::Server> server_;
   std::unique_ptr<storage::IStorage> storage_;
+  std::unique_ptr<core::IThreadPool> storage_pool_;
+  std::unique_ptr<WriteCoalescer> write_coalescer_;
+  std::unique_ptr<AdmissionController> admission_;
+  SubscriberRegistry subscribers_;
+  CallEnvironment env_;
 
   std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> completion_queues_;
+  std::vector<std::unique_ptr<CallDataPool>> call_data_pools_;
+  std::vector<std::vector<size_t>> worker_cpus_;
   std::vector<std::thread> threads_;
 };
 
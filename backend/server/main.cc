@@ -2,14 +2,17 @@
 #include "backend/server.h"
 #include "core/backtrace.h"
 #include "core/exception.h"
+#include "core/trace.h"
 #include "storage/api.h"
 
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
 
 #include <fstream>
+#include <thread>
 
 #include <csignal>
+#include <pthread.h>
 #include <unistd.h>
 
 static backend::RpcServer* server_ptr = nullptr;
@@ -26,6 +29,31 @@ void RegisterSignalHandlers(backend::RpcServer* server) {
   std::signal(SIGINT, SignalHandler);
 }
 
+// Blocks SIGUSR1 in the calling thread, the threads it starts later inherit the mask.
+sigset_t BlockTraceSignal() {
+  sigset_t set;
+  sigemptyset(&set);
+  sigaddset(&set, SIGUSR1);
+  pthread_sigmask(SIG_BLOCK, &set, nullptr);
+  return set;
+}
+
+// Writes the trace on every SIGUSR1, the dump allocates so it can not run in a signal handler.
+void StartTraceDumper(const sigset_t& set, const std::string& trace_file) {
+  std::thread([set, trace_file] {
+    int signal;
+    while (sigwait(&set, &signal) == 0) {
+      std::ofstream out(trace_file, std::ios::trunc);
+      out << core::trace::DumpChromeTrace(core::trace::Collect());
+      if (out.good()) {
+        chat_log_info("trace written to {}", trace_file);
+      } else {
+        chat_log_error("can not write trace to {}", trace_file);
+      }
+    }
+  }).detach();
+}
+
 ABSL_FLAG(bool, daemon, false, "run as daemon");
 ABSL_FLAG(std::string, config, "config.ini", "config file");
 
@@ -45,6 +73,8 @@ int main(int argc, char** argv) {
     return 1;
   }
 
+  const auto trace_signal = BlockTraceSignal();
+
   std::unique_ptr<storage::IStorage> storage;
   try {
     storage = storage::CreateStorage(config.storage_config);
@@ -62,21 +92,26 @@ int main(int argc, char** argv) {
     return 1;
   }
 
-  chat_server_log("Finished loading configs");
+  chat_log_info("Finished loading configs");
 
   std::ofstream pid_out(config.pid_file);
   pid_out << getpid() << std::endl;
   pid_out.close();
 
-  chat_server_log("Server pid: " + std::to_string(getpid()));
-  chat_server_log("Finished writing pidfile");
+  chat_log_info("Server pid: {}", getpid());
+  chat_log_info("Finished writing pidfile");
 
-  auto server = backend::RpcServer(config.threads_num, std::move(storage));
+  // the server logs until it is destroyed, the logger is flushed after it
+  {
+    auto server = backend::RpcServer(config, std::move(storage));
 
-  server.Start(config.host + ":" + std::to_string(config.port));
-  chat_server_log("Server is listening on " + config.host + ":" + std::to_string(config.port));
+    server.Start(config.host + ":" + std::to_string(config.port));
+    chat_log_info("Server is listening on {}:{}", config.host, config.port);
 
-  RegisterSignalHandlers(&server);
-  server.WaitForStop();
+    RegisterSignalHandlers(&server);
+    StartTraceDumper(trace_signal, config.trace_file);
+    server.WaitForStop();
+  }
+  backend::ShutdownLogger();
   return 0;
 }
@@ -0,0 +1,110 @@
+#include "subscriber_registry.h"
+
+#include "core/datetime.h"
+#include "core/guard.h"
+
+#include "absl/container/flat_hash_set.h"
+
+#include <algorithm>
+
+namespace backend {
+
+SubscriberRegistry::SubscriberRegistry() = default;
+
+SubscriberRegistry::~SubscriberRegistry() = default;
+
+bool SubscriberRegistry::Add(const std::vector<std::string>& addressees, const SubscriberRef& subscriber) {
+  core_with_lock(lock_) {
+    if (stopped_) {
+      return false;
+    }
+    for (const auto& addressee : addressees) {
+      subscribers_[addressee].push_back(subscriber);
+    }
+  }
+  return true;
+}
+
+void SubscriberRegistry::Remove(const std::vector<std::string>& addressees, const ISubscriber* subscriber) {
+  core_with_lock(lock_) {
+    for (const auto& addressee : addressees) {
+      auto it = subscribers_.find(addressee);
+      if (it == subscribers_.end()) {
+        continue;
+      }
+      auto& list = it->second;
+      list.erase(
+          std::remove_if(list.begin(), list.end(), [subscriber](const auto& s) { return s.get() == subscriber; }),
+          list.end());
+      if (list.empty()) {
+        subscribers_.erase(it);
+      }
+    }
+  }
+}
+
+void SubscriberRegistry::Publish(const proto::Message& message, const storage::IStorage::Uids& uids) {
+  // delayed messages are delivered by ReceiveMessage once their send time has come
+  if (message.send_ts() > static_cast<uint64_t>(absl::ToUnixSeconds(absl::Now()))) {
+    return;
+  }
+
+  struct Target {
+    SubscriberRef subscriber;
+    uint64_t uid;
+  };
+  std::vector<Target> targets;
+  core_with_lock(lock_) {
+    absl::flat_hash_set<const ISubscriber*> seen;
+    for (int i = 0; i < message.to_size(); ++i) {
+      const auto it = subscribers_.find(message.to(i));
+      if (it == subscribers_.end()) {
+        continue;
+      }
+      const auto uid = static_cast<size_t>(i) < uids.size() ? uids[i] : message.message_uid();
+      for (const auto& subscriber : it->second) {
+        if (seen.insert(subscriber.get()).second) {
+          targets.push_back({subscriber, uid});
+        }
+      }
+    }
+  }
+
+  // subscribers of addressees that share a uid share the response
+  std::vector<std::shared_ptr<const proto::SubscribeResponse>> responses;
+  for (const auto& target : targets) {
+    const auto found = std::find_if(responses.begin(), responses.end(),
+                                    [&target](const auto& r) { return r->message().message_uid() == target.uid; });
+    if (found != responses.end()) {
+      target.subscriber->Push(*found);
+      continue;
+    }
+    auto response = std::make_shared<proto::SubscribeResponse>();
+    *response->mutable_message() = message;
+    response->mutable_message()->set_message_uid(target.uid);
+    responses.push_back(std::move(response));
+    target.subscriber->Push(responses.back());
+  }
+}
+
+void SubscriberRegistry::Stop() {
+  std::vector<SubscriberRef> all;
+  core_with_lock(lock_) {
+    stopped_ = true;
+    absl::flat_hash_set<const ISubscriber*> seen;
+    for (const auto& [addressee, list] : subscribers_) {
+      for (const auto& subscriber : list) {
+        if (seen.insert(subscriber.get()).second) {
+          all.push_back(subscriber);
+        }
+      }
+    }
+    subscribers_.clear();
+  }
+
+  for (const auto& subscriber : all) {
+    subscriber->Close();
+  }
+}
+
+}  // namespace backend
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "core/intrusive_ptr.h"
+#include "core/mutex.h"
+#include "proto/subscribe.pb.h"
+#include "storage/storage.h"
+
+#include "absl/container/flat_hash_map.h"
+#include "grpcpp/grpcpp.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace backend {
+
+// The end of a Subscribe stream the registry writes to, SubscribeCallData in the server.
+class ISubscriber : public core::AtomicRefCount<ISubscriber> {
+ public:
+  explicit ISubscriber(long refs = 0) noexcept
+      : core::AtomicRefCount<ISubscriber>(refs) {}
+
+  virtual ~ISubscriber() = default;
+
+  virtual void Push(const std::shared_ptr<const proto::SubscribeResponse>& response) = 0;
+
+  virtual void Close(const grpc::Status& status = grpc::Status::OK) = 0;
+};
+
+// Fan-out table of the live Subscribe streams, keyed by every addressee
+// (user, group, #all) a subscriber receives messages for.
+class SubscriberRegistry {
+ public:
+  using SubscriberRef = core::IntrusivePtr<ISubscriber>;
+
+  SubscriberRegistry();
+  ~SubscriberRegistry();
+
+  // Returns false once the registry is stopped, the caller must close the stream itself.
+  bool Add(const std::vector<std::string>& addressees, const SubscriberRef& subscriber);
+
+  void Remove(const std::vector<std::string>& addressees, const ISubscriber* subscriber);
+
+  // Pushes the stored message to every subscriber of any of its recipients, each subscriber gets it once. `uids` are
+  // the ones the storage assigned to the addressees, a subscriber gets the uid of the first addressee it follows, so
+  // it can resume ReceiveMessage from a pushed message.
+  void Publish(const proto::Message& message, const storage::IStorage::Uids& uids);
+
+  // Closes all streams and rejects new ones, must be called before grpc::Server::Shutdown.
+  void Stop();
+
+ private:
+  core::Mutex lock_;
+  bool stopped_ = false;
+  absl::flat_hash_map<std::string, std::vector<SubscriberRef>> subscribers_;
+};
+
+}  // namespace backend
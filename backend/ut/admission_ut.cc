@@ -0,0 +1,166 @@
+#include "backend/admission.h"
+
+#include "gtest/gtest.h"
+
+using backend::AdmissionController;
+using backend::RpcMethod;
+
+namespace {
+
+AdmissionController::Params AdaptiveParams(size_t initial_limit) {
+  AdmissionController::Params params;
+  params.adaptive = true;
+  params.initial_limit = initial_limit;
+  params.min_limit = 4;
+  params.max_limit = 1024;
+  return params;
+}
+
+void Acquire(AdmissionController* admission, size_t calls) {
+  for (size_t i = 0; i < calls; ++i) {
+    ASSERT_TRUE(admission->TryAcquire(RpcMethod::kReceiveMessage));
+  }
+}
+
+}  // namespace
+
+TEST(AdmissionController, TestPerMethodLimit) {
+  AdmissionController::Params params;
+  params.max_in_flight_per_method = 2;
+  AdmissionController admission(params);
+
+  ASSERT_TRUE(admission.TryAcquire(RpcMethod::kSendMessage));
+  ASSERT_TRUE(admission.TryAcquire(RpcMethod::kSendMessage));
+  ASSERT_FALSE(admission.TryAcquire(RpcMethod::kSendMessage));
+  ASSERT_EQ(admission.Rejected(), 1);
+
+  // every method has a limit of its own
+  ASSERT_TRUE(admission.TryAcquire(RpcMethod::kReceiveMessage));
+
+  admission.Release(RpcMethod::kSendMessage);
+  ASSERT_TRUE(admission.TryAcquire(RpcMethod::kSendMessage));
+  ASSERT_EQ(admission.Rejected(), 1);
+}
+
+TEST(AdmissionController, TestNoLimits) {
+  AdmissionController admission(AdmissionController::Params{});
+  for (size_t i = 0; i < 10000; ++i) {
+    ASSERT_TRUE(admission.TryAcquire(RpcMethod::kSendMessage));
+  }
+  ASSERT_EQ(admission.Rejected(), 0);
+
+  // without the adaptive limit samples change nothing
+  const auto limit = admission.Limit();
+  admission.Sample(RpcMethod::kReceiveMessage, absl::Milliseconds(1));
+  admission.Sample(RpcMethod::kReceiveMessage, absl::Seconds(1));
+  ASSERT_EQ(admission.Limit(), limit);
+}
+
+TEST(AdmissionController, TestAdaptiveLimit) {
+  AdmissionController admission(AdaptiveParams(8));
+  ASSERT_EQ(admission.Limit(), 8);
+
+  // the limit bounds all the methods together
+  Acquire(&admission, 4);
+  for (size_t i = 0; i < 4; ++i) {
+    ASSERT_TRUE(admission.TryAcquire(RpcMethod::kSendMessage));
+  }
+  ASSERT_FALSE(admission.TryAcquire(RpcMethod::kSendedMessages));
+  ASSERT_EQ(admission.Rejected(), 1);
+
+  admission.Release(RpcMethod::kSendMessage);
+  ASSERT_TRUE(admission.TryAcquire(RpcMethod::kSendedMessages));
+}
+
+TEST(AdmissionController, TestBurstDecreasesOnce) {
+  AdmissionController admission(AdaptiveParams(100));
+  admission.Sample(RpcMethod::kReceiveMessage, absl::Milliseconds(1));
+  ASSERT_EQ(admission.Limit(), 100);
+
+  // a burst of slow completions within one round shrinks the limit once
+  for (size_t i = 0; i < 50; ++i) {
+    admission.Sample(RpcMethod::kReceiveMessage, absl::Milliseconds(10));
+  }
+  ASSERT_EQ(admission.Limit(), 90);
+
+  // the next round may shrink it again
+  for (size_t i = 0; i < 90; ++i) {
+    admission.Sample(RpcMethod::kReceiveMessage, absl::Milliseconds(10));
+  }
+  ASSERT_EQ(admission.Limit(), 81);
+
+  for (size_t i = 0; i < 100000; ++i) {
+    admission.Sample(RpcMethod::kReceiveMessage, absl::Milliseconds(10));
+  }
+  ASSERT_EQ(admission.Limit(), 4);
+}
+
+TEST(AdmissionController, TestIncreaseOncePerRound) {
+  AdmissionController admission(AdaptiveParams(10));
+  Acquire(&admission, 10);
+
+  for (size_t i = 0; i < 9; ++i) {
+    admission.Sample(RpcMethod::kReceiveMessage, absl::Milliseconds(1));
+  }
+  ASSERT_EQ(admission.Limit(), 10);
+  admission.Sample(RpcMethod::kReceiveMessage, absl::Milliseconds(1));
+  ASSERT_EQ(admission.Limit(), 11);
+
+  // a round of the new limit has one sample more
+  for (size_t i = 0; i < 10; ++i) {
+    admission.Sample(RpcMethod::kReceiveMessage, absl::Milliseconds(1));
+  }
+  ASSERT_EQ(admission.Limit(), 11);
+  admission.Sample(RpcMethod::kReceiveMessage, absl::Milliseconds(1));
+  ASSERT_EQ(admission.Limit(), 12);
+}
+
+TEST(AdmissionController, TestNoIncreaseWhenIdle) {
+  AdmissionController admission(AdaptiveParams(10));
+  Acquire(&admission, 2);
+
+  // fast calls do not grow a limit they are far from using
+  for (size_t i = 0; i < 1000; ++i) {
+    admission.Sample(RpcMethod::kReceiveMessage, absl::Milliseconds(1));
+  }
+  ASSERT_EQ(admission.Limit(), 10);
+}
+
+TEST(AdmissionController, TestNoIncreaseAfterDecrease) {
+  AdmissionController admission(AdaptiveParams(20));
+  Acquire(&admission, 20);
+  admission.Sample(RpcMethod::kReceiveMessage, absl::Milliseconds(1));
+  admission.Sample(RpcMethod::kReceiveMessage, absl::Milliseconds(10));
+  ASSERT_EQ(admission.Limit(), 18);
+
+  // the round that shrank the limit does not grow it back
+  for (size_t i = 0; i < 17; ++i) {
+    admission.Sample(RpcMethod::kReceiveMessage, absl::Milliseconds(1));
+  }
+  ASSERT_EQ(admission.Limit(), 18);
+  admission.Sample(RpcMethod::kReceiveMessage, absl::Milliseconds(1));
+  ASSERT_EQ(admission.Limit(), 18);
+
+  for (size_t i = 0; i < 18; ++i) {
+    admission.Sample(RpcMethod::kReceiveMessage, absl::Milliseconds(1));
+  }
+  ASSERT_EQ(admission.Limit(), 19);
+}
+
+TEST(AdmissionController, TestMixedMethods) {
+  AdmissionController admission(AdaptiveParams(20));
+  Acquire(&admission, 20);
+
+  // a commit always takes longer than a read, that alone is no congestion
+  for (size_t i = 0; i < 10000; ++i) {
+    admission.Sample(RpcMethod::kReceiveMessage, absl::Microseconds(100));
+    admission.Sample(RpcMethod::kSendMessage, absl::Milliseconds(2));
+    admission.Sample(RpcMethod::kSendedMessages, absl::Milliseconds(10));
+  }
+  ASSERT_GT(admission.Limit(), 20);
+
+  // a method slower than its own minimum still is
+  const auto limit = admission.Limit();
+  admission.Sample(RpcMethod::kSendMessage, absl::Milliseconds(5));
+  ASSERT_EQ(admission.Limit(), limit * 9 / 10);
+}
@@ -0,0 +1,133 @@
+#include "backend/subscriber_registry.h"
+
+#include "core/datetime.h"
+
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <vector>
+
+using backend::SubscriberRegistry;
+
+namespace {
+
+class FakeSubscriber final : public backend::ISubscriber {
+ public:
+  void Push(const std::shared_ptr<const proto::SubscribeResponse>& response) override { pushed.push_back(response); }
+
+  void Close(const grpc::Status& status) override {
+    closed = true;
+    close_status = status;
+  }
+
+  std::vector<std::shared_ptr<const proto::SubscribeResponse>> pushed;
+  bool closed = false;
+  grpc::Status close_status;
+};
+
+using FakeRef = core::IntrusivePtr<FakeSubscriber>;
+
+proto::Message MakeMessage(std::vector<std::string> to) {
+  proto::Message message;
+  message.set_from("from");
+  for (auto& addressee : to) {
+    message.add_to(std::move(addressee));
+  }
+  message.set_send_ts(static_cast<uint64_t>(absl::ToUnixSeconds(absl::Now())));
+  message.set_message("hello");
+  return message;
+}
+
+}  // namespace
+
+TEST(SubscriberRegistry, TestPublish) {
+  SubscriberRegistry registry;
+  FakeRef user1(new FakeSubscriber);
+  FakeRef user2(new FakeSubscriber);
+  FakeRef other(new FakeSubscriber);
+  ASSERT_TRUE(registry.Add({"user1", "@group"}, user1.get()));
+  ASSERT_TRUE(registry.Add({"user2"}, user2.get()));
+  ASSERT_TRUE(registry.Add({"user3"}, other.get()));
+
+  const auto message = MakeMessage({"@group", "user1", "user2"});
+  registry.Publish(message, {10, 11, 12});
+
+  // user1 follows two addressees of the message and gets it once, with the uid of the first one
+  ASSERT_EQ(user1->pushed.size(), 1);
+  ASSERT_EQ(user1->pushed[0]->message().message_uid(), 10);
+  ASSERT_EQ(user1->pushed[0]->message().message(), "hello");
+  ASSERT_EQ(user2->pushed.size(), 1);
+  ASSERT_EQ(user2->pushed[0]->message().message_uid(), 12);
+  ASSERT_TRUE(other->pushed.empty());
+
+  registry.Stop();
+}
+
+TEST(SubscriberRegistry, TestSharedUid) {
+  SubscriberRegistry registry;
+  FakeRef user1(new FakeSubscriber);
+  FakeRef user2(new FakeSubscriber);
+  ASSERT_TRUE(registry.Add({"user1"}, user1.get()));
+  ASSERT_TRUE(registry.Add({"user2"}, user2.get()));
+
+  registry.Publish(MakeMessage({"user1", "user2"}), {7, 7});
+  ASSERT_EQ(user1->pushed.size(), 1);
+  ASSERT_EQ(user2->pushed.size(), 1);
+  ASSERT_EQ(user1->pushed[0], user2->pushed[0]);
+  ASSERT_EQ(user1->pushed[0]->message().message_uid(), 7);
+
+  registry.Stop();
+}
+
+TEST(SubscriberRegistry, TestDelayedMessage) {
+  SubscriberRegistry registry;
+  FakeRef user1(new FakeSubscriber);
+  ASSERT_TRUE(registry.Add({"user1"}, user1.get()));
+
+  auto message = MakeMessage({"user1"});
+  message.set_send_ts(message.send_ts() + 3600);
+  registry.Publish(message, {1});
+  ASSERT_TRUE(user1->pushed.empty());
+
+  registry.Stop();
+}
+
+TEST(SubscriberRegistry, TestRemove) {
+  SubscriberRegistry registry;
+  FakeRef user1(new FakeSubscriber);
+  FakeRef user2(new FakeSubscriber);
+  ASSERT_TRUE(registry.Add({"user1", "@group"}, user1.get()));
+  ASSERT_TRUE(registry.Add({"@group"}, user2.get()));
+
+  registry.Remove({"user1", "@group"}, user1.get());
+  registry.Publish(MakeMessage({"user1", "@group"}), {1, 2});
+  ASSERT_TRUE(user1->pushed.empty());
+  ASSERT_EQ(user2->pushed.size(), 1);
+  ASSERT_EQ(user2->pushed[0]->message().message_uid(), 2);
+
+  // removing an unknown subscriber or addressee is a no-op
+  registry.Remove({"user1", "unknown"}, user1.get());
+
+  registry.Stop();
+  ASSERT_FALSE(user1->closed);
+  ASSERT_TRUE(user2->closed);
+}
+
+TEST(SubscriberRegistry, TestStop) {
+  SubscriberRegistry registry;
+  FakeRef user1(new FakeSubscriber);
+  FakeRef user2(new FakeSubscriber);
+  ASSERT_TRUE(registry.Add({"user1", "@group"}, user1.get()));
+  ASSERT_TRUE(registry.Add({"user2"}, user2.get()));
+
+  registry.Stop();
+  ASSERT_TRUE(user1->closed);
+  ASSERT_TRUE(user1->close_status.ok());
+  ASSERT_TRUE(user2->closed);
+
+  FakeRef late(new FakeSubscriber);
+  ASSERT_FALSE(registry.Add({"user1"}, late.get()));
+  registry.Publish(MakeMessage({"user1", "user2"}), {1, 2});
+  ASSERT_TRUE(user1->pushed.empty());
+  ASSERT_TRUE(user2->pushed.empty());
+}
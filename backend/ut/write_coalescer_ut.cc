@@ -0,0 +1,89 @@
+#include "backend/write_coalescer.h"
+
+#include "gtest/gtest.h"
+
+#include <vector>
+
+namespace {
+
+// Answers a batch with `results` entries, the first ones stored.
+struct FakeStorage final : public storage::IStorage {
+  Uids Store(const proto::Message& message) override { return Uids(message.to_size(), ++uid); }
+
+  std::vector<bool> StoreBatch(const google::protobuf::RepeatedPtrField<proto::Message>& messages,
+                               std::vector<Uids>* uids = nullptr) override {
+    batches.push_back(messages.size());
+    std::vector<bool> stored(results, true);
+    if (uids != nullptr) {
+      uids->clear();
+      for (const auto& message : messages) {
+        uids->push_back(Store(message));
+      }
+    }
+    return stored;
+  }
+
+  std::vector<proto::Message> Load(const std::vector<std::string>& /* possible_addressees */) override { return {}; }
+
+  std::vector<proto::Message> LoadSended(const std::string& /* user */) override { return {}; }
+
+  size_t results = 0;
+  uint64_t uid = 0;
+  std::vector<int> batches;
+};
+
+struct Waiter final : public backend::WriteCoalescer::IWaiter {
+  void OnStored(bool s, const storage::IStorage::Uids& u, core::Duration /* store_time */) override {
+    ++calls;
+    stored = s;
+    uids = u;
+  }
+
+  size_t calls = 0;
+  bool stored = false;
+  storage::IStorage::Uids uids;
+};
+
+proto::Message MakeMessage() {
+  proto::Message message;
+  message.set_from("from");
+  message.add_to("to");
+  return message;
+}
+
+}  // namespace
+
+TEST(WriteCoalescer, TestBatch) {
+  FakeStorage storage;
+  storage.results = 2;
+  std::vector<Waiter> waiters(2);
+  {
+    backend::WriteCoalescer coalescer(&storage, absl::Seconds(10), 2);
+    for (auto& waiter : waiters) {
+      coalescer.Submit(MakeMessage(), &waiter);
+    }
+  }
+  ASSERT_EQ(storage.batches, std::vector<int>({2}));
+  for (size_t i = 0; i < waiters.size(); ++i) {
+    ASSERT_EQ(waiters[i].calls, 1);
+    ASSERT_TRUE(waiters[i].stored);
+    ASSERT_EQ(waiters[i].uids, storage::IStorage::Uids({i + 1}));
+  }
+}
+
+TEST(WriteCoalescer, TestShortResult) {
+  FakeStorage storage;
+  storage.results = 1;
+  std::vector<Waiter> waiters(2);
+  {
+    backend::WriteCoalescer coalescer(&storage, absl::Seconds(10), 2);
+    for (auto& waiter : waiters) {
+      coalescer.Submit(MakeMessage(), &waiter);
+    }
+  }
+  for (const auto& waiter : waiters) {
+    ASSERT_EQ(waiter.calls, 1);
+    ASSERT_FALSE(waiter.stored);
+    ASSERT_TRUE(waiter.uids.empty());
+  }
+}
@@ -0,0 +1,106 @@
+#include "write_coalescer.h"
+#include "logging.h"
+
+#include "core/exception.h"
+#include "core/guard.h"
+
+#include <algorithm>
+
+namespace backend {
+
+WriteCoalescer::WriteCoalescer(storage::IStorage* storage, core::Duration window, size_t max_batch)
+    : storage_(storage)
+    , window_(window)
+    , max_batch_(std::max<size_t>(max_batch, 1)) {
+  waiters_.reserve(max_batch_);
+  writer_ = std::thread(&WriteCoalescer::WriterLoop, this);
+}
+
+WriteCoalescer::~WriteCoalescer() { Stop(); }
+
+void WriteCoalescer::Submit(const proto::Message& message, IWaiter* waiter) {
+  core_with_lock(lock_) {
+    if (!stopped_) {
+      if (waiters_.empty()) {
+        batch_start_ = core::Time::now();
+      }
+      *batch_.Add() = message;
+      waiters_.push_back(waiter);
+      if (waiters_.size() == 1 || waiters_.size() >= max_batch_) {
+        wakeup_.signal();
+      }
+      return;
+    }
+  }
+
+  bool stored = true;
+  storage::IStorage::Uids uids;
+  const auto start = core::Time::now();
+  try {
+    uids = storage_->Store(message);
+  } catch (const core::Exception& e) {
+    LogStorageError(e);
+    stored = false;
+  }
+  waiter->OnStored(stored, uids, core::Time::now() - start);
+}
+
+void WriteCoalescer::Stop() {
+  core_with_lock(lock_) {
+    stopped_ = true;
+    wakeup_.signal();
+  }
+  if (writer_.joinable()) {
+    writer_.join();
+  }
+}
+
+void WriteCoalescer::WriterLoop() {
+  // swapped with the shared buffers, so both keep their allocations between batches
+  google::protobuf::RepeatedPtrField<proto::Message> batch;
+  std::vector<IWaiter*> waiters;
+  waiters.reserve(max_batch_);
+
+  while (true) {
+    core_with_lock(lock_) {
+      wakeup_.wait(lock_, [this] { return stopped_ || !waiters_.empty(); });
+      if (waiters_.empty()) {
+        return;
+      }
+      wakeup_.wait(lock_, batch_start_ + window_, [this] { return stopped_ || waiters_.size() >= max_batch_; });
+      batch_.Swap(&batch);
+      waiters_.swap(waiters);
+    }
+
+    Flush(batch, waiters);
+    batch.Clear();
+    waiters.clear();
+  }
+}
+
+void WriteCoalescer::Flush(const google::protobuf::RepeatedPtrField<proto::Message>& batch,
+                           const std::vector<IWaiter*>& waiters) {
+  std::vector<bool> stored;
+  std::vector<storage::IStorage::Uids> uids;
+  const auto start = core::Time::now();
+  try {
+    stored = storage_->StoreBatch(batch, &uids);
+    // a result of another size from the storage plugin fails every waiter
+    if (stored.size() != waiters.size()) {
+      core_throw core::Exception() << "storage returned " << stored.size() << " results for a batch of "
+                                   << waiters.size() << " messages";
+    }
+  } catch (const core::Exception& e) {
+    LogStorageError(e);
+    stored.assign(waiters.size(), false);
+    uids.clear();
+  }
+  const auto store_time = core::Time::now() - start;
+  // a storage that does not report uids publishes the messages as sent
+  uids.resize(waiters.size());
+  for (size_t i = 0; i < waiters.size(); ++i) {
+    waiters[i]->OnStored(stored[i], uids[i], store_time);
+  }
+}
+
+}  // namespace backend
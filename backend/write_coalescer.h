@@ -0,0 +1,56 @@
+#pragma once
+
+#include "core/condvar.h"
+#include "core/datetime.h"
+#include "core/mutex.h"
+#include "storage/storage.h"
+
+#include <thread>
+#include <vector>
+
+namespace backend {
+
+// Group commit of single message stores: messages submitted from any thread during one window are written by a
+// single IStorage::StoreBatch call, every waiter is completed once its batch is written.
+class WriteCoalescer {
+ public:
+  struct IWaiter {
+    virtual ~IWaiter() = default;
+
+    // `uids` are the ones the storage assigned to the message, empty if it was not stored. `store_time` is how long
+    // the storage wrote the batch, without the wait for the batch to be collected.
+    virtual void OnStored(bool stored, const storage::IStorage::Uids& uids, core::Duration store_time) = 0;
+  };
+
+ public:
+  // A batch is written when the window since its first message passes or max_batch messages are collected.
+  WriteCoalescer(storage::IStorage* storage, core::Duration window, size_t max_batch);
+
+  ~WriteCoalescer();
+
+  void Submit(const proto::Message& message, IWaiter* waiter);
+
+  // Writes the pending batch and stops the writer, later submits are stored inline.
+  void Stop();
+
+ private:
+  void WriterLoop();
+
+  void Flush(const google::protobuf::RepeatedPtrField<proto::Message>& batch, const std::vector<IWaiter*>& waiters);
+
+ private:
+  storage::IStorage* storage_;
+  core::Duration window_;
+  size_t max_batch_;
+
+  core::Mutex lock_;
+  core::CondVar wakeup_;
+  bool stopped_ = false;
+  core::Instant batch_start_;
+  google::protobuf::RepeatedPtrField<proto::Message> batch_;
+  std::vector<IWaiter*> waiters_;
+
+  std::thread writer_;
+};
+
+}  // namespace backend
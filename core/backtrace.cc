@@ -105,6 +105,15 @@ BackTrace::BackTrace() noexcept
 
 void BackTrace::capture() noexcept { size_ = core::BackTrace(data_.data(), kCapacity_); }
 
+uint64_t BackTrace::hash() const noexcept {
+  // FNV-1a over the frame addresses
+  uint64_t result = 14695981039346656037ull;
+  for (size_t i = 0; i < size_; ++i) {
+    result = (result ^ static_cast<uint64_t>(reinterpret_cast<uintptr_t>(data_[i]))) * 1099511628211ull;
+  }
+  return result;
+}
+
 void BackTrace::printTo(std::ostream& out) const noexcept { FormatBackTrace(out, data_.data(), size_); }
 
 std::string BackTrace::toString() const noexcept {
@@ -4,6 +4,7 @@
 
 #include <array>
 #include <cstddef>
+#include <cstdint>
 #include <ostream>
 #include <string>
 
@@ -26,8 +27,15 @@ class BackTrace {
  public:
   BackTrace() noexcept;
 
+  // Only unwinds, the frames are symbolized by printTo and toString.
   void capture() noexcept;
 
+  core_warn_unused_result inline void* const* frames() const noexcept { return data_.data(); }
+  core_warn_unused_result inline size_t size() const noexcept { return size_; }
+
+  // Equal for equal frames.
+  core_warn_unused_result uint64_t hash() const noexcept;
+
   void printTo(std::ostream& out) const noexcept;
 
   core_warn_unused_result std::string toString() const noexcept;
@@ -0,0 +1,42 @@
+#include "backtrace_cache.h"
+#include "guard.h"
+#include "singleton.h"
+
+#include <sstream>
+
+core::BackTraceCache& core::BackTraceCache::instance() { return *Singleton<BackTraceCache>(); }
+
+uint64_t core::BackTraceCache::add(const class BackTrace& bt) {
+  const auto hash = bt.hash();
+  core_with_lock(lock_) {
+    if (stacks_.size() < kMaxStacks && !stacks_.contains(hash)) {
+      stacks_[hash].frames.assign(bt.frames(), bt.frames() + bt.size());
+    }
+  }
+  return hash;
+}
+
+std::string core::BackTraceCache::symbolize(uint64_t hash) {
+  std::vector<void*> frames;
+  core_with_lock(lock_) {
+    auto it = stacks_.find(hash);
+    if (it == stacks_.end()) {
+      return {};
+    }
+    if (!it->second.symbolized.empty()) {
+      return it->second.symbolized;
+    }
+    frames = it->second.frames;
+  }
+
+  // dladdr and demangling are slow, they run without the lock
+  std::ostringstream out;
+  FormatBackTrace(out, frames.data(), frames.size());
+  auto symbolized = out.str();
+  core_with_lock(lock_) { stacks_[hash].symbolized = symbolized; }
+  return symbolized;
+}
+
+size_t core::BackTraceCache::size() const noexcept {
+  core_with_lock(lock_) { return stacks_.size(); }
+}
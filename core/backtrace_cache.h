@@ -0,0 +1,43 @@
+#pragma once
+
+#include "backtrace.h"
+#include "mutex.h"
+#include "noncopyable.h"
+
+#include "absl/container/flat_hash_map.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace core {
+
+// Stacks keyed by the hash of their frames. A repeated stack is stored and symbolized once, so code that logs
+// a backtrace per error only pays for the unwinding.
+class BackTraceCache : public NonCopyable {
+ public:
+  // Stacks added beyond the limit are not kept.
+  static constexpr size_t kMaxStacks = 1024;
+
+  static BackTraceCache& instance();
+
+  // Keeps the frames of a stack not seen before, returns the hash of the stack.
+  uint64_t add(const class BackTrace& bt);
+
+  // Symbolized frames of the stack, resolved on the first call. Empty for a stack that is not kept.
+  std::string symbolize(uint64_t hash);
+
+  size_t size() const noexcept;
+
+ private:
+  struct Stack {
+    std::vector<void*> frames;
+    std::string symbolized;
+  };
+
+ private:
+  mutable Mutex lock_;
+  absl::flat_hash_map<uint64_t, Stack> stacks_;
+};
+
+}  // namespace core
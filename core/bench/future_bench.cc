@@ -0,0 +1,34 @@
+#include "core/bench/thread_counts.h"
+#include "core/future.h"
+
+static void BM_FutureSubscribe(benchmark::State& state) {
+  int sum = 0;
+  for (auto _ : state) {
+    auto promise = core::NewPromise<int>();
+    promise.getFuture().subscribe([&sum](const core::Future<int>& f) { sum += f.getValue(); });
+    promise.setValue(1);
+  }
+  benchmark::DoNotOptimize(sum);
+  state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_FutureApply(benchmark::State& state) {
+  for (auto _ : state) {
+    auto future = core::MakeFuture(1).apply([](const core::Future<int>& f) { return f.getValue() + 1; });
+    benchmark::DoNotOptimize(future.getValue());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// All threads read the same ready future.
+static void BM_FutureGetValue(benchmark::State& state) {
+  static const auto future = core::MakeFuture(1);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(future.getValue());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_FutureSubscribe)->Apply(ThreadCounts);
+BENCHMARK(BM_FutureApply)->Apply(ThreadCounts);
+BENCHMARK(BM_FutureGetValue)->Apply(ThreadCounts);
@@ -0,0 +1,45 @@
+#include "core/bench/thread_counts.h"
+#include "core/intrusive_ptr.h"
+
+#include <memory>
+
+namespace {
+
+struct Object : public core::AtomicRefCount<Object> {
+  int value = 0;
+};
+
+}  // namespace
+
+// Every thread copies its own pointer, the reference count stays in the thread's cache.
+static void BM_IntrusivePtrCopy(benchmark::State& state) {
+  core::IntrusivePtr<Object> ptr(new Object);
+  for (auto _ : state) {
+    core::IntrusivePtr<Object> copy(ptr);
+    benchmark::DoNotOptimize(copy.get());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// All threads copy one pointer and contend for its reference count.
+static void BM_IntrusivePtrCopyShared(benchmark::State& state) {
+  static const core::IntrusivePtr<Object> ptr(new Object);
+  for (auto _ : state) {
+    core::IntrusivePtr<Object> copy(ptr);
+    benchmark::DoNotOptimize(copy.get());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_SharedPtrCopy(benchmark::State& state) {
+  auto ptr = std::make_shared<Object>();
+  for (auto _ : state) {
+    std::shared_ptr<Object> copy(ptr);
+    benchmark::DoNotOptimize(copy.get());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_IntrusivePtrCopy)->Apply(ThreadCounts);
+BENCHMARK(BM_IntrusivePtrCopyShared)->Apply(ThreadCounts);
+BENCHMARK(BM_SharedPtrCopy)->Apply(ThreadCounts);
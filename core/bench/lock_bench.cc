@@ -0,0 +1,20 @@
+#include "core/bench/thread_counts.h"
+#include "core/mutex.h"
+#include "core/spinlock.h"
+
+template <class Lock>
+static void BM_AcquireRelease(benchmark::State& state) {
+  // shared by all benchmark threads, one thread measures the uncontended path
+  static Lock lock;
+  static size_t counter = 0;
+  for (auto _ : state) {
+    lock.acquire();
+    benchmark::DoNotOptimize(++counter);
+    lock.release();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_AcquireRelease, core::SpinLock)->Apply(ThreadCounts);
+BENCHMARK_TEMPLATE(BM_AcquireRelease, core::AdaptiveLock)->Apply(ThreadCounts);
+BENCHMARK_TEMPLATE(BM_AcquireRelease, core::Mutex)->Apply(ThreadCounts);
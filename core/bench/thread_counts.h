@@ -0,0 +1,16 @@
+#pragma once
+
+#include "benchmark/benchmark.h"
+
+#include <algorithm>
+#include <thread>
+
+// Runs a benchmark with 1, 2, 4, ... threads and with as many threads as the machine has.
+inline void ThreadCounts(benchmark::internal::Benchmark* benchmark) {
+  const int max_threads = static_cast<int>(std::max(2u, std::thread::hardware_concurrency()));
+  for (int threads = 1; threads < max_threads; threads *= 2) {
+    benchmark->Threads(threads);
+  }
+  benchmark->Threads(max_threads);
+  benchmark->UseRealTime();
+}
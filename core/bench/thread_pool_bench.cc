@@ -0,0 +1,41 @@
+#include "core/bench/thread_counts.h"
+#include "core/event.h"
+#include "core/thread_pool.h"
+
+#include <memory>
+
+template <class Pool>
+static Pool& StartedPool() {
+  static auto pool = [] {
+    auto result = std::make_unique<Pool>();
+    result->start(std::max(2u, std::thread::hardware_concurrency()));
+    return result;
+  }();
+  return *pool;
+}
+
+// Cost of queueing a task for the caller, the workers drain the queue concurrently.
+static void BM_ThreadPoolAdd(benchmark::State& state) {
+  auto& pool = StartedPool<core::ThreadPool>();
+  for (auto _ : state) {
+    pool.safeAddFunc([] {});
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Time from queueing a task until the caller learns it has run.
+template <class Pool>
+static void BM_RoundTrip(benchmark::State& state) {
+  auto& pool = StartedPool<Pool>();
+  core::AutoEvent done;
+  for (auto _ : state) {
+    pool.safeAddFunc([&done] { done.signal(); });
+    done.wait();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_ThreadPoolAdd)->Apply(ThreadCounts);
+BENCHMARK_TEMPLATE(BM_RoundTrip, core::ThreadPool)->Apply(ThreadCounts);
+// AdaptiveThreadPool hands every task to an idle thread or a new one.
+BENCHMARK_TEMPLATE(BM_RoundTrip, core::AdaptiveThreadPool)->Apply(ThreadCounts);
@@ -0,0 +1,22 @@
+#include "core/bench/thread_counts.h"
+#include "core/tls.h"
+
+static void BM_TlsValueGet(benchmark::State& state) {
+  static core::tls::Value<int> value;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(++value.get());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Compiler supported thread locals, the lower bound for tls::Value.
+static void BM_PodThreadGet(benchmark::State& state) {
+  core_pod_static_thread(int) value;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(++value);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_TlsValueGet)->Apply(ThreadCounts);
+BENCHMARK(BM_PodThreadGet)->Apply(ThreadCounts);
@@ -38,7 +38,7 @@ class CondVar {
 
   template <class P>
   inline void wait(Mutex& m, P pred) noexcept {
-    return wait(m, Time::infiniteFuture(), std::move(pred));
+    wait(m, Time::infiniteFuture(), std::move(pred));
   }
 
  private:
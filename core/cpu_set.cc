@@ -0,0 +1,87 @@
+#include "cpu_set.h"
+#include "exception.h"
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <string>
+
+namespace {
+
+constexpr const char* kNodeDir = "/sys/devices/system/node/";
+
+size_t ParseCpu(std::string_view token, std::string_view list) {
+  size_t cpu = 0;
+  auto [end, ec] = std::from_chars(token.data(), token.data() + token.size(), cpu);
+  if (token.empty() || ec != std::errc() || end != token.data() + token.size()) {
+    core_throw core::Exception() << "bad cpu list '" << list << "'";
+  }
+  return cpu;
+}
+
+bool ReadLine(const std::string& path, std::string* line) {
+  std::ifstream in(path);
+  return in && std::getline(in, *line);
+}
+
+bool ReadNodeCpuList(size_t node, std::string* list) {
+  return ReadLine(kNodeDir + ("node" + std::to_string(node)) + "/cpulist", list);
+}
+
+}  // namespace
+
+std::vector<size_t> core::ParseCpuList(std::string_view list) {
+  std::vector<size_t> cpus;
+  while (!list.empty() && (list.back() == '\n' || list.back() == ' ')) {
+    list.remove_suffix(1);
+  }
+  for (std::string_view rest = list; !rest.empty();) {
+    auto comma = rest.find(',');
+    auto item = rest.substr(0, comma);
+    rest = comma == std::string_view::npos ? std::string_view() : rest.substr(comma + 1);
+    if (comma != std::string_view::npos && rest.empty()) {
+      core_throw Exception() << "bad cpu list '" << list << "'";
+    }
+
+    auto dash = item.find('-');
+    if (dash == std::string_view::npos) {
+      cpus.push_back(ParseCpu(item, list));
+      continue;
+    }
+    auto first = ParseCpu(item.substr(0, dash), list);
+    auto last = ParseCpu(item.substr(dash + 1), list);
+    if (first > last) {
+      core_throw Exception() << "bad cpu range '" << item << "'";
+    }
+    for (auto cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  return cpus;
+}
+
+std::vector<size_t> core::NumaNodes() {
+  // node ids are not dense, offline and hot-plugged nodes leave gaps
+  std::string list;
+  if (ReadLine(std::string(kNodeDir) + "online", &list) || ReadLine(std::string(kNodeDir) + "possible", &list)) {
+    try {
+      if (auto nodes = ParseCpuList(list); !nodes.empty()) {
+        return nodes;
+      }
+    } catch (const Exception&) {
+    }
+  }
+  return {0};
+}
+
+size_t core::NumaNodeCount() { return NumaNodes().size(); }
+
+std::vector<size_t> core::NumaNodeCpus(size_t node) {
+  std::string list;
+  if (!ReadNodeCpuList(node, &list)) {
+    return {};
+  }
+  return ParseCpuList(list);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+namespace core {
+
+// Parses a Linux cpu list ("0-3,8,10-11"), the result is sorted and unique. Throws Exception on malformed input.
+std::vector<size_t> ParseCpuList(std::string_view list);
+
+// Ids of the online NUMA nodes, sorted, {0} on systems without NUMA support.
+std::vector<size_t> NumaNodes();
+
+// Number of online NUMA nodes, 1 on systems without NUMA support.
+size_t NumaNodeCount();
+
+// CPUs of the NUMA node, empty if the node does not exist.
+std::vector<size_t> NumaNodeCpus(size_t node);
+
+}  // namespace core
@@ -5,6 +5,17 @@
 
 namespace core {
 
+#ifdef CORE_LOCK_PROFILING
+namespace lock_profiler {
+
+class Site;
+
+template <class Lock>
+void Acquire(Lock* lock, Site& site) noexcept;
+
+}  // namespace lock_profiler
+#endif
+
 template <class Lock>
 struct LockTraits {
   static inline void acquire(Lock* l) noexcept { l->acquire(); }
@@ -31,6 +42,14 @@ class Guarded : public NonCopyable {
 
   inline Guarded(const Lock* lock) noexcept { init(lock); }
 
+#ifdef CORE_LOCK_PROFILING
+  // Acquires with the profiler, the lock is released by Traits.
+  inline Guarded(const Lock* lock, lock_profiler::Site& site) noexcept
+      : lock_(const_cast<Lock*>(lock)) {
+    lock_profiler::Acquire(lock_, site);
+  }
+#endif
+
   inline Guarded(Guarded&& g) noexcept
       : lock_(g.lock_) {
     g.lock_ = nullptr;
@@ -69,6 +88,13 @@ static inline Guarded<T> Guard(const T& t) noexcept {
   return {&t};
 }
 
+#ifdef CORE_LOCK_PROFILING
+template <class T>
+static inline Guarded<T> ProfiledGuard(const T& t, lock_profiler::Site& site) noexcept {
+  return {&t, site};
+}
+#endif
+
 template <class T, class Traits>
 static inline InverseGuarded<T, Traits> Unguard(const Guarded<T, Traits>& g) {
   return {g.getLock()};
@@ -81,9 +107,20 @@ static inline InverseGuarded<T> Unguard(const T& t) {
 
 }  // namespace core
 
+#ifdef CORE_LOCK_PROFILING
+#include "lock_profiler.h"
+
+#define core_with_lock(lock)                                                            \
+  if (auto core_unique_id(__guard) = ::core::ProfiledGuard(lock, core_lock_site())) { \
+    goto core_concat(GUARD_LABEL, __LINE__);                                            \
+  } else                                                                                \
+    core_concat(GUARD_LABEL, __LINE__)                                                  \
+        :
+#else
 #define core_with_lock(lock)                                \
   if (auto core_unique_id(__guard) = ::core::Guard(lock)) { \
     goto core_concat(GUARD_LABEL, __LINE__);                \
   } else                                                    \
     core_concat(GUARD_LABEL, __LINE__)                      \
         :
+#endif
@@ -0,0 +1,115 @@
+#include "lock_profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <tuple>
+
+namespace {
+
+// Sites are static locals that live until exit, so the list is only ever pushed to.
+core::Atomic sites_head = 0;
+
+}  // namespace
+
+namespace core::lock_profiler {
+
+class Sites {
+ public:
+  static void push(Site* site) noexcept {
+    auto head = atomics::Load(sites_head);
+    for (;;) {
+      site->next_ = reinterpret_cast<Site*>(head);
+      const auto seen = atomics::GetAndCas(&sites_head, reinterpret_cast<AtomicType>(site), head);
+      if (seen == head) {
+        return;
+      }
+      head = seen;
+    }
+  }
+
+  template <class F>
+  static void forEach(F&& f) {
+    for (auto* site = reinterpret_cast<Site*>(atomics::Load(sites_head)); site != nullptr; site = site->next_) {
+      f(*site);
+    }
+  }
+
+  static SiteStats stats(const Site& site) noexcept {
+    return {site.location_, static_cast<uint64_t>(atomics::Load(site.acquisitions_)),
+            static_cast<uint64_t>(atomics::Load(site.contended_)), static_cast<uint64_t>(atomics::Load(site.spins_)),
+            static_cast<uint64_t>(atomics::Load(site.wait_ns_))};
+  }
+
+  static void reset(Site& site) noexcept {
+    atomics::Store(site.acquisitions_, 0);
+    atomics::Store(site.contended_, 0);
+    atomics::Store(site.spins_, 0);
+    atomics::Store(site.wait_ns_, 0);
+  }
+};
+
+Site::Site(SourceLocation location) noexcept
+    : location_(location) {
+  Sites::push(this);
+}
+
+std::vector<SiteStats> Collect() {
+  // every inline function or template instantiation expanding the site has its own counters
+  std::map<std::tuple<std::string_view, int>, SiteStats> merged;
+  Sites::forEach([&](const Site& site) {
+    const auto stats = Sites::stats(site);
+    auto [it, inserted] = merged.try_emplace({stats.location.file, stats.location.line}, stats);
+    if (!inserted) {
+      it->second.acquisitions += stats.acquisitions;
+      it->second.contended += stats.contended;
+      it->second.spins += stats.spins;
+      it->second.wait_ns += stats.wait_ns;
+    }
+  });
+
+  std::vector<SiteStats> result;
+  result.reserve(merged.size());
+  for (auto& [key, stats] : merged) {
+    if (stats.acquisitions != 0) {
+      result.push_back(stats);
+    }
+  }
+  std::stable_sort(result.begin(), result.end(), [](const SiteStats& lhs, const SiteStats& rhs) {
+    return std::tie(lhs.wait_ns, lhs.contended) > std::tie(rhs.wait_ns, rhs.contended);
+  });
+  return result;
+}
+
+void Reset() noexcept {
+  Sites::forEach([](Site& site) { Sites::reset(site); });
+}
+
+std::string Format(const std::vector<SiteStats>& stats, size_t top) {
+  if (!kEnabled) {
+    return "lock profiling is disabled, build with -DCORE_LOCK_PROFILING\n";
+  }
+
+  std::string result;
+  char buf[512];
+  snprintf(buf, sizeof(buf), "%-60s %12s %12s %8s %12s %12s\n", "site", "acquisitions", "contended", "%",
+           "spins", "wait ms");
+  result += buf;
+  for (size_t i = 0; i < std::min(top, stats.size()); ++i) {
+    const auto& s = stats[i];
+    auto file = s.location.file;
+    // the tail of the path is enough to find the site
+    if (file.size() > 50) {
+      file.remove_prefix(file.size() - 50);
+    }
+    const std::string site = std::string(file) + ":" + std::to_string(s.location.line);
+    snprintf(buf, sizeof(buf), "%-60s %12llu %12llu %8.2f %12llu %12.3f\n", site.c_str(),
+             static_cast<unsigned long long>(s.acquisitions), static_cast<unsigned long long>(s.contended),
+             s.acquisitions == 0 ? 0.0 : 100.0 * static_cast<double>(s.contended) / static_cast<double>(s.acquisitions),
+             static_cast<unsigned long long>(s.spins), static_cast<double>(s.wait_ns) / 1e6);
+    result += buf;
+  }
+  return result;
+}
+
+}  // namespace core::lock_profiler
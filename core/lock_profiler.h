@@ -0,0 +1,148 @@
+#pragma once
+
+#include "atomic.h"
+#include "noncopyable.h"
+#include "spinlock.h"
+#include "src_location.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Lock contention profiling of core_with_lock, built with -DCORE_LOCK_PROFILING (bazel --config=lock_profiling).
+// Every core_with_lock site counts its acquisitions, the ones that found the lock taken, the spin iterations and the
+// time spent waiting. Without the define core_with_lock is unchanged and the report is empty.
+
+namespace core {
+
+namespace lock_profiler {
+
+#ifdef CORE_LOCK_PROFILING
+inline constexpr bool kEnabled = true;
+#else
+inline constexpr bool kEnabled = false;
+#endif
+
+// Counters of one acquisition site, created on its first acquisition and never destroyed.
+class Site : public NonCopyable {
+ public:
+  explicit Site(SourceLocation location) noexcept;
+
+  inline void record(bool contended, uint64_t spins, uint64_t wait_ns) noexcept {
+    atomics::Increment(acquisitions_);
+    if (contended) {
+      atomics::Increment(contended_);
+      atomics::Add(spins_, static_cast<AtomicType>(spins));
+      atomics::Add(wait_ns_, static_cast<AtomicType>(wait_ns));
+    }
+  }
+
+ private:
+  friend class Sites;
+
+  SourceLocation location_;
+  Atomic acquisitions_ = 0;
+  Atomic contended_ = 0;
+  Atomic spins_ = 0;
+  Atomic wait_ns_ = 0;
+  Site* next_ = nullptr;
+};
+
+struct SiteStats {
+  SourceLocation location;
+  uint64_t acquisitions = 0;
+  uint64_t contended = 0;
+  uint64_t spins = 0;
+  uint64_t wait_ns = 0;
+};
+
+// Counters of all sites merged by location, the longest total wait first.
+std::vector<SiteStats> Collect();
+
+// Zeroes the counters, e.g. to profile a single load run.
+void Reset() noexcept;
+
+// A table of the top sites for logs and the stats RPC.
+std::string Format(const std::vector<SiteStats>& stats, size_t top = 20);
+
+namespace detail {
+
+template <class Lock, class = void>
+struct HasTryAcquire : std::false_type {};
+
+template <class Lock>
+struct HasTryAcquire<Lock, std::void_t<decltype(std::declval<Lock&>().tryAcquire())>> : std::true_type {};
+
+template <class Lock>
+inline bool TryAcquire(Lock* lock) noexcept {
+  return lock->tryAcquire();
+}
+
+inline bool TryAcquire(Atomic* lock) noexcept { return atomics::TryLock(lock); }
+
+// Blocks until the taken lock is acquired, returns the spin iterations. Locks that block in the kernel do not spin.
+template <class Lock>
+inline uint64_t AcquireContended(Lock* lock) noexcept {
+  LockTraits<Lock>::acquire(lock);
+  return 0;
+}
+
+inline uint64_t AcquireContended(SpinLock* lock) noexcept {
+  uint64_t spins = 0;
+  do {
+    SpinLockBase::spinLockPause();
+    ++spins;
+  } while (lock->isLocked() || !lock->tryAcquire());
+  return spins;
+}
+
+inline uint64_t AcquireContended(AdaptiveLock* lock) noexcept {
+  uint64_t spins = 0;
+  SpinWait sw;
+  do {
+    sw.sleep();
+    ++spins;
+  } while (lock->isLocked() || !lock->tryAcquire());
+  return spins;
+}
+
+inline uint64_t AcquireContended(Atomic* lock) noexcept {
+  uint64_t spins = 0;
+  SpinWait sw;
+  do {
+    sw.sleep();
+    ++spins;
+  } while (!atomics::TryAndTryLock(lock));
+  return spins;
+}
+
+}  // namespace detail
+
+// Acquires the lock like LockTraits<Lock> does and records it. A lock without tryAcquire always counts as contended.
+template <class Lock>
+void Acquire(Lock* lock, Site& site) noexcept {
+  if constexpr (detail::HasTryAcquire<Lock>::value || std::is_same_v<Lock, Atomic>) {
+    if (detail::TryAcquire(lock)) {
+      site.record(false, 0, 0);
+      return;
+    }
+  }
+  const auto start = std::chrono::steady_clock::now();
+  const auto spins = detail::AcquireContended(lock);
+  const auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+  site.record(true, spins, static_cast<uint64_t>(wait.count()));
+}
+
+}  // namespace lock_profiler
+
+}  // namespace core
+
+// The site of the expansion, one per template instantiation.
+#define core_lock_site()                                                   \
+  []() -> ::core::lock_profiler::Site& {                                   \
+    static ::core::lock_profiler::Site site(core_source_location);         \
+    return site;                                                           \
+  }()
@@ -0,0 +1,199 @@
+#include "metrics.h"
+#include "guard.h"
+#include "singleton.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <tuple>
+
+namespace {
+
+core::Atomic next_shard = 0;
+
+}  // namespace
+
+size_t core::metrics::detail::CurrentShard() noexcept {
+  // threads keep coming and going, the ids wrap over the cells
+  static thread_local size_t shard = static_cast<size_t>(atomics::GetAndIncrement(next_shard)) % kShards;
+  return shard;
+}
+
+core::AtomicType core::metrics::Counter::value() const noexcept {
+  AtomicType result = 0;
+  for (const auto& cell : cells_) {
+    result += atomics::Load(cell.value);
+  }
+  return result;
+}
+
+uint64_t core::metrics::HistogramSnapshot::valueAtQuantile(double q) const noexcept {
+  if (count == 0) {
+    return 0;
+  }
+  const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(count))));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      return std::min(Histogram::bucketUpperBound(i), max);
+    }
+  }
+  return max;
+}
+
+struct alignas(64) core::metrics::Histogram::Shard {
+  Atomic count = 0;
+  Atomic sum = 0;
+  Atomic max = 0;
+  std::array<Atomic, kBuckets> buckets{};
+};
+
+core::metrics::Histogram::Histogram()
+    : shards_(new Shard[kShards]) {}
+
+core::metrics::Histogram::~Histogram() = default;
+
+void core::metrics::Histogram::record(Duration value) noexcept {
+  recordValue(value < Duration() ? 0 : static_cast<uint64_t>(absl::ToInt64Nanoseconds(value)));
+}
+
+void core::metrics::Histogram::recordValue(uint64_t value) noexcept {
+  auto& shard = shards_[detail::CurrentShard() % kShards];
+  atomics::Increment(shard.count);
+  atomics::Add(shard.sum, static_cast<AtomicType>(value));
+  atomics::Increment(shard.buckets[bucketIndex(value)]);
+
+  const auto v = static_cast<AtomicType>(std::min<uint64_t>(value, uint64_t(1) << 62));
+  for (auto max = atomics::Load(shard.max); v > max; max = atomics::Load(shard.max)) {
+    if (atomics::Cas(&shard.max, v, max)) {
+      break;
+    }
+  }
+}
+
+core::metrics::HistogramSnapshot core::metrics::Histogram::snapshot() const {
+  HistogramSnapshot result;
+  result.buckets.resize(kBuckets);
+  for (size_t s = 0; s < kShards; ++s) {
+    const auto& shard = shards_[s];
+    result.count += atomics::Load(shard.count);
+    result.sum += atomics::Load(shard.sum);
+    result.max = std::max<uint64_t>(result.max, atomics::Load(shard.max));
+    for (size_t i = 0; i < kBuckets; ++i) {
+      result.buckets[i] += atomics::Load(shard.buckets[i]);
+    }
+  }
+  return result;
+}
+
+size_t core::metrics::Histogram::bucketIndex(uint64_t value) noexcept {
+  if (value < kSubBuckets) {
+    return value;
+  }
+  const size_t exponent = 63 - __builtin_clzll(value);
+  if (exponent > kMaxExponent) {
+    return kBuckets - 1;
+  }
+  const size_t shift = exponent - kSubBucketBits;
+  return kSubBuckets + shift * kSubBuckets + ((value >> shift) & (kSubBuckets - 1));
+}
+
+uint64_t core::metrics::Histogram::bucketUpperBound(size_t index) noexcept {
+  if (index < kSubBuckets) {
+    return index;
+  }
+  const size_t shift = (index - kSubBuckets) / kSubBuckets;
+  const uint64_t sub = (index - kSubBuckets) % kSubBuckets;
+  return ((kSubBuckets + sub + 1) << shift) - 1;
+}
+
+core::metrics::Registry& core::metrics::Registry::instance() { return *Singleton<Registry>(); }
+
+template <class T>
+T& core::metrics::Registry::getOrCreate(Family<T>& family, std::string_view name, std::string_view labels) {
+  core_with_lock(lock_) {
+    auto key = std::make_pair(std::string(name), std::string(labels));
+    auto it = family.find(key);
+    if (it == family.end()) {
+      it = family.emplace(std::move(key), std::make_unique<T>()).first;
+    }
+    return *it->second;
+  }
+}
+
+core::metrics::Counter& core::metrics::Registry::counter(std::string_view name, std::string_view labels) {
+  return getOrCreate(counters_, name, labels);
+}
+
+core::metrics::Gauge& core::metrics::Registry::gauge(std::string_view name, std::string_view labels) {
+  return getOrCreate(gauges_, name, labels);
+}
+
+core::metrics::Histogram& core::metrics::Registry::histogram(std::string_view name, std::string_view labels) {
+  return getOrCreate(histograms_, name, labels);
+}
+
+std::vector<core::metrics::MetricSample> core::metrics::Registry::collect() const {
+  std::vector<MetricSample> result;
+  core_with_lock(lock_) {
+    for (const auto& [key, counter] : counters_) {
+      result.push_back({MetricSample::Kind::kCounter, key.first, key.second, counter->value(), {}});
+    }
+    for (const auto& [key, gauge] : gauges_) {
+      result.push_back({MetricSample::Kind::kGauge, key.first, key.second, gauge->value(), {}});
+    }
+    for (const auto& [key, histogram] : histograms_) {
+      result.push_back({MetricSample::Kind::kHistogram, key.first, key.second, 0, histogram->snapshot()});
+    }
+  }
+  std::stable_sort(result.begin(), result.end(), [](const auto& lhs, const auto& rhs) {
+    return std::tie(lhs.name, lhs.labels) < std::tie(rhs.name, rhs.labels);
+  });
+  return result;
+}
+
+static std::string Seconds(uint64_t ns) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.9g", static_cast<double>(ns) / 1e9);
+  return buf;
+}
+
+static std::string Labels(const std::string& labels, const std::string& extra = {}) {
+  if (labels.empty() && extra.empty()) {
+    return {};
+  }
+  if (labels.empty() || extra.empty()) {
+    return "{" + labels + extra + "}";
+  }
+  return "{" + labels + "," + extra + "}";
+}
+
+std::string core::metrics::DumpPrometheus(const std::vector<MetricSample>& samples) {
+  static constexpr double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+  std::string result;
+  const std::string* last_name = nullptr;
+  for (const auto& sample : samples) {
+    if (last_name == nullptr || *last_name != sample.name) {
+      const char* type = sample.kind == MetricSample::Kind::kCounter ? "counter"
+                         : sample.kind == MetricSample::Kind::kGauge ? "gauge"
+                                                                     : "summary";
+      result += "# TYPE " + sample.name + " " + type + "\n";
+      last_name = &sample.name;
+    }
+    if (sample.kind != MetricSample::Kind::kHistogram) {
+      result += sample.name + Labels(sample.labels) + " " + std::to_string(sample.value) + "\n";
+      continue;
+    }
+    for (auto q : kQuantiles) {
+      char quantile[32];
+      snprintf(quantile, sizeof(quantile), "quantile=\"%g\"", q);
+      result += sample.name + Labels(sample.labels, quantile) + " " +
+                Seconds(sample.histogram.valueAtQuantile(q)) + "\n";
+    }
+    result += sample.name + "_sum" + Labels(sample.labels) + " " + Seconds(sample.histogram.sum) + "\n";
+    result += sample.name + "_count" + Labels(sample.labels) + " " + std::to_string(sample.histogram.count) + "\n";
+  }
+  return result;
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "atomic.h"
+#include "datetime.h"
+#include "mutex.h"
+#include "noncopyable.h"
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace core {
+
+namespace metrics {
+
+namespace detail {
+
+// Cells are updated by the shard of the calling thread only, so threads rarely share a cache line.
+inline constexpr size_t kShards = 16;
+
+size_t CurrentShard() noexcept;
+
+struct alignas(64) Cell {
+  Atomic value = 0;
+};
+
+}  // namespace detail
+
+class Counter : public NonCopyable {
+ public:
+  inline void inc(AtomicType n = 1) noexcept { atomics::Add(cells_[detail::CurrentShard()].value, n); }
+
+  AtomicType value() const noexcept;
+
+ private:
+  std::array<detail::Cell, detail::kShards> cells_{};
+};
+
+class Gauge : public NonCopyable {
+ public:
+  inline void set(AtomicType v) noexcept { atomics::Store(value_, v); }
+  inline void add(AtomicType n) noexcept { atomics::Add(value_, n); }
+
+  inline AtomicType value() const noexcept { return atomics::Load(value_); }
+
+ private:
+  Atomic value_ = 0;
+};
+
+struct HistogramSnapshot {
+  // an upper bound of the value below which the given fraction of samples falls, 0 without samples
+  uint64_t valueAtQuantile(double q) const noexcept;
+
+  uint64_t count = 0;
+  uint64_t sum = 0;
+  uint64_t max = 0;
+  std::vector<uint64_t> buckets;
+};
+
+// Latency histogram with log-linear buckets in the spirit of HdrHistogram: every power of two is split into
+// kSubBuckets equal buckets, so a reported quantile is at most 1/kSubBuckets above the real one. Values are
+// nanoseconds and saturate at 2^kMaxExponent.
+class Histogram : public NonCopyable {
+ public:
+  static constexpr size_t kSubBucketBits = 5;
+  static constexpr size_t kSubBuckets = size_t(1) << kSubBucketBits;
+  static constexpr size_t kMaxExponent = 40;
+  static constexpr size_t kBuckets = kSubBuckets + (kMaxExponent - kSubBucketBits + 1) * kSubBuckets;
+
+  // Histograms are large, threads share fewer shards than counters.
+  static constexpr size_t kShards = 4;
+
+ public:
+  Histogram();
+  ~Histogram();
+
+  void record(Duration value) noexcept;
+  void recordValue(uint64_t value) noexcept;
+
+  HistogramSnapshot snapshot() const;
+
+  static size_t bucketIndex(uint64_t value) noexcept;
+  // the largest value that falls into the bucket
+  static uint64_t bucketUpperBound(size_t index) noexcept;
+
+ private:
+  struct Shard;
+
+  std::unique_ptr<Shard[]> shards_;
+};
+
+// Measures the lifetime of the object into a histogram.
+class ScopedLatency : public NonCopyable {
+ public:
+  explicit inline ScopedLatency(Histogram& histogram) noexcept
+      : histogram_(histogram)
+      , start_(Time::now()) {}
+
+  inline ~ScopedLatency() { histogram_.record(Time::now() - start_); }
+
+ private:
+  Histogram& histogram_;
+  Instant start_;
+};
+
+struct MetricSample {
+  enum class Kind { kCounter, kGauge, kHistogram };
+
+  Kind kind;
+  std::string name;
+  // Prometheus label set without braces, e.g. method="SendMessage"
+  std::string labels;
+  AtomicType value = 0;
+  HistogramSnapshot histogram;
+};
+
+// Process wide set of named metrics. Lookups take a lock, callers keep the returned reference and update it
+// without one; metrics live as long as the process.
+class Registry : public NonCopyable {
+ public:
+  static Registry& instance();
+
+  Counter& counter(std::string_view name, std::string_view labels = {});
+  Gauge& gauge(std::string_view name, std::string_view labels = {});
+  Histogram& histogram(std::string_view name, std::string_view labels = {});
+
+  // All metrics ordered by name and labels.
+  std::vector<MetricSample> collect() const;
+
+ private:
+  template <class T>
+  using Family = std::map<std::pair<std::string, std::string>, std::unique_ptr<T>, std::less<>>;
+
+  template <class T>
+  T& getOrCreate(Family<T>& family, std::string_view name, std::string_view labels);
+
+ private:
+  mutable Mutex lock_;
+  Family<Counter> counters_;
+  Family<Gauge> gauges_;
+  Family<Histogram> histograms_;
+};
+
+// Prometheus text exposition of the samples. Histograms become summaries in seconds with the 0.5, 0.9, 0.99 and
+// 0.999 quantiles.
+std::string DumpPrometheus(const std::vector<MetricSample>& samples);
+
+}  // namespace metrics
+
+}  // namespace core
@@ -7,6 +7,7 @@
 #include <limits>
 
 #include <pthread.h>
+#include <sched.h>
 #include <string.h>
 
 #include <sys/prctl.h>
@@ -264,6 +265,31 @@ std::string Thread::currentThreadName() noexcept {
   return name;
 }
 
+bool Thread::setCurrentThreadAffinity(const std::vector<size_t>& cpus) noexcept {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto cpu : cpus) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  return CPU_COUNT(&set) > 0 && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+std::vector<size_t> Thread::currentThreadAffinity() noexcept {
+  std::vector<size_t> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+    for (size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+  return cpus;
+}
+
 namespace {
 
 template <class T>
@@ -5,6 +5,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace core {
 
@@ -85,6 +86,10 @@ class Thread {
   static void setCurrentThreadName(const char* name) noexcept;
   static std::string currentThreadName() noexcept;
 
+  // Pins the calling thread to the given CPUs, false if the system refused (e.g. none of them is online).
+  static bool setCurrentThreadAffinity(const std::vector<size_t>& cpus) noexcept;
+  static std::vector<size_t> currentThreadAffinity() noexcept;
+
  private:
   struct CallableBase {
     virtual ~CallableBase() = default;
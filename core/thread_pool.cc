@@ -42,6 +42,23 @@ class ThreadNamer {
   core::Atomic index_{0};
 };
 
+class ThreadPinner {
+ public:
+  ThreadPinner(const core::IThreadPool::Params& params)
+      : cpus_(params.affinity) {}
+
+  explicit operator bool() const { return !cpus_.empty(); }
+
+  void pinCurrentThread() const {
+    if (!core::Thread::setCurrentThreadAffinity(cpus_)) {
+      std::cerr << "can not pin thread " << core::Thread::currentThreadName() << " to the requested cpus" << std::endl;
+    }
+  }
+
+ private:
+  std::vector<size_t> cpus_;
+};
+
 }  // namespace
 
 core::ThreadFactoryHolder::ThreadFactoryHolder() noexcept
@@ -49,7 +66,13 @@ core::ThreadFactoryHolder::ThreadFactoryHolder() noexcept
 
 class core::ThreadPool::Impl : public core::IntrusiveListItem<Impl>, public IThreadFactory::IThreadAble {
   using Tsr = IThreadPool::Tsr;
-  using JobQueue = std::queue<IObjectInQueue*>;
+
+  struct Job {
+    IObjectInQueue* obj;
+    Instant enqueued;
+  };
+
+  using JobQueue = std::queue<Job>;
   using ThreadRef = std::unique_ptr<IThreadFactory::IThread>;
 
  public:
@@ -58,6 +81,7 @@ class core::ThreadPool::Impl : public core::IntrusiveListItem<Impl>, public IThr
       , blocking_(p.blocking)
       , catching_(p.catching)
       , namer_(p)
+      , pinner_(p)
       , should_terminate_(1)
       , max_queue_size_(0)
       , thread_count_expected_(0)
@@ -83,14 +107,18 @@ class core::ThreadPool::Impl : public core::IntrusiveListItem<Impl>, public IThr
     }
 
     if (thread_array_.empty()) {
+      atomics::Increment(added_);
       Tsr tsr(parent_);
+      const auto started = Time::now();
       obj->process(&tsr);
+      execution_time_.record(Time::now() - started);
       return true;
     }
 
     core_with_lock(queue_mutex_) {
       while (max_queue_size_ > 0 && queue_.size() >= max_queue_size_ && !atomics::Load(should_terminate_)) {
         if (!blocking_) {
+          atomics::Increment(rejected_);
           return false;
         }
         queue_pop_cond_.wait(queue_mutex_);
@@ -100,8 +128,9 @@ class core::ThreadPool::Impl : public core::IntrusiveListItem<Impl>, public IThr
         return false;
       }
 
-      queue_.push(obj);
+      queue_.push({obj, Time::now()});
     }
+    atomics::Increment(added_);
 
     queue_push_cond_.signal();
 
@@ -118,6 +147,18 @@ class core::ThreadPool::Impl : public core::IntrusiveListItem<Impl>, public IThr
 
   inline auto threadCountReal() const noexcept { return thread_count_real_; }
 
+  inline auto stats() const {
+    ThreadPoolStats result;
+    result.threads = thread_count_real_;
+    result.queue_size = size();
+    result.added = static_cast<uint64_t>(atomics::Load(added_));
+    result.rejected = static_cast<uint64_t>(atomics::Load(rejected_));
+    result.threads_spawned = threads_spawned_;
+    result.queue_delay = queue_delay_.snapshot();
+    result.execution_time = execution_time_.snapshot();
+    return result;
+  }
+
   inline void atForkAction() noexcept { forked_ = true; }
 
   inline auto needRestart() const noexcept { return forked_; }
@@ -131,6 +172,7 @@ class core::ThreadPool::Impl : public core::IntrusiveListItem<Impl>, public IThr
       for (size_t i = 0; i < num; ++i) {
         thread_array_.push_back(parent_->factory()->run(this));
         ++thread_count_real_;
+        ++threads_spawned_;
       }
     } catch (...) {
       stop();
@@ -165,9 +207,12 @@ class core::ThreadPool::Impl : public core::IntrusiveListItem<Impl>, public IThr
     if (namer_) {
       namer_.setCurrentThreadName();
     }
+    if (pinner_) {
+      pinner_.pinCurrentThread();
+    }
 
     while (true) {
-      IObjectInQueue* job = nullptr;
+      Job job{};
 
       core_with_lock(queue_mutex_) {
         while (queue_.empty() && !atomics::Load(should_terminate_)) {
@@ -185,18 +230,21 @@ class core::ThreadPool::Impl : public core::IntrusiveListItem<Impl>, public IThr
 
       queue_pop_cond_.signal();
 
+      const auto started = Time::now();
+      queue_delay_.record(started - job.enqueued);
       if (catching_) {
         try {
           try {
-            job->process(*tsr);
+            job.obj->process(*tsr);
           } catch (...) {
             std::cerr << "[thread pool] " << CurrentExceptionMessage() << std::endl;
           }
         } catch (...) {
         }
       } else {
-        job->process(*tsr);
+        job.obj->process(*tsr);
       }
+      execution_time_.record(Time::now() - started);
     }
 
     finishOneThread();
@@ -245,6 +293,7 @@ class core::ThreadPool::Impl : public core::IntrusiveListItem<Impl>, public IThr
   const bool blocking_;
   const bool catching_;
   ThreadNamer namer_;
+  ThreadPinner pinner_;
 
   mutable Mutex queue_mutex_{};
   mutable Mutex stop_mutex_{};
@@ -257,10 +306,15 @@ class core::ThreadPool::Impl : public core::IntrusiveListItem<Impl>, public IThr
   std::vector<ThreadRef> thread_array_;
 
   Atomic should_terminate_;
+  Atomic added_ = 0;
+  Atomic rejected_ = 0;
+  metrics::Histogram queue_delay_;
+  metrics::Histogram execution_time_;
 
   size_t max_queue_size_;
   size_t thread_count_expected_;
   size_t thread_count_real_;
+  size_t threads_spawned_ = 0;
 
   bool forked_;
 };
@@ -277,6 +331,8 @@ size_t core::ThreadPool::threadCountExpected() const noexcept {
 
 size_t core::ThreadPool::threadCountReal() const noexcept { return (impl_.get() ? impl_->threadCountReal() : 0); }
 
+core::ThreadPoolStats core::ThreadPool::stats() const { return impl_.get() ? impl_->stats() : ThreadPoolStats{}; }
+
 bool core::ThreadPool::add(IObjectInQueue* obj) {
   core_ensure(impl_.get(), ThreadPoolException() << "thread pool not started");
   if (impl_->needRestart()) {
@@ -310,12 +366,18 @@ class core::AdaptiveThreadPool::Impl {
       if (impl_->namer_) {
         impl_->namer_.setCurrentThreadName();
       }
+      if (impl_->pinner_) {
+        impl_->pinner_.pinCurrentThread();
+      }
 
       {
         Tsr tsr(impl_->parent_);
         IObjectInQueue* obj;
+        Instant enqueued;
 
-        while ((obj = impl_->waitForJob()) != nullptr) {
+        while ((obj = impl_->waitForJob(&enqueued)) != nullptr) {
+          const auto started = Time::now();
+          impl_->queue_delay_.record(started - enqueued);
           if (impl_->catching_) {
             try {
               try {
@@ -328,6 +390,7 @@ class core::AdaptiveThreadPool::Impl {
           } else {
             obj->process(tsr);
           }
+          impl_->execution_time_.record(Time::now() - started);
         }
       }
     }
@@ -341,6 +404,7 @@ class core::AdaptiveThreadPool::Impl {
       : parent_(parent)
       , catching_(p.catching)
       , namer_(p)
+      , pinner_(p)
       , thread_count_(0)
       , all_done_(false)
       , obj_(nullptr)
@@ -366,6 +430,8 @@ class core::AdaptiveThreadPool::Impl {
       }
 
       obj_ = obj;
+      obj_enqueued_ = Time::now();
+      ++added_;
 
       core_ensure(!all_done_, ThreadPoolException() << "adding to a stopped queue");
     }
@@ -384,6 +450,20 @@ class core::AdaptiveThreadPool::Impl {
 
   core_warn_unused_result inline size_t size() const noexcept { return atomics::Load(thread_count_); }
 
+  inline ThreadPoolStats stats() const {
+    ThreadPoolStats result;
+    result.threads = size();
+    core_with_lock(mutex_) {
+      result.queue_size = obj_ != nullptr ? 1 : 0;
+      result.added = added_;
+      result.threads_spawned = threads_spawned_;
+      result.idle_exits = idle_exits_;
+    }
+    result.queue_delay = queue_delay_.snapshot();
+    result.execution_time = execution_time_.snapshot();
+    return result;
+  }
+
  private:
   inline void incThreadCount() noexcept { atomics::Increment(thread_count_); }
 
@@ -397,6 +477,7 @@ class core::AdaptiveThreadPool::Impl {
       decThreadCount();
       throw;
     }
+    ++threads_spawned_;
   }
 
   inline void stop() noexcept {
@@ -412,7 +493,7 @@ class core::AdaptiveThreadPool::Impl {
     mutex_.release();
   }
 
-  inline IObjectInQueue* waitForJob() noexcept {
+  inline IObjectInQueue* waitForJob(Instant* enqueued) noexcept {
     mutex_.acquire();
     ++free_;
 
@@ -424,6 +505,10 @@ class core::AdaptiveThreadPool::Impl {
 
     IObjectInQueue* ret = obj_;
     obj_ = nullptr;
+    *enqueued = obj_enqueued_;
+    if (ret == nullptr && !all_done_) {
+      ++idle_exits_;
+    }
 
     --free_;
     mutex_.release();
@@ -437,14 +522,22 @@ class core::AdaptiveThreadPool::Impl {
   const bool catching_;
 
   ThreadNamer namer_;
+  ThreadPinner pinner_;
   Atomic thread_count_;
 
-  Mutex mutex_;
+  mutable Mutex mutex_;
   CondVar cond_ready_;
   CondVar cond_free_;
 
   bool all_done_;
   IObjectInQueue* obj_;
+  Instant obj_enqueued_;
+
+  uint64_t added_ = 0;
+  uint64_t threads_spawned_ = 0;
+  uint64_t idle_exits_ = 0;
+  metrics::Histogram queue_delay_;
+  metrics::Histogram execution_time_;
 
   size_t free_;
   char name_[64];
@@ -481,6 +574,10 @@ void core::AdaptiveThreadPool::stop() noexcept { impl_.reset(); }
 
 size_t core::AdaptiveThreadPool::size() const noexcept { return impl_.get() ? impl_->size() : 0; }
 
+core::ThreadPoolStats core::AdaptiveThreadPool::stats() const {
+  return impl_.get() ? impl_->stats() : ThreadPoolStats{};
+}
+
 void core::AdaptiveThreadPool::setMaxIdleTime(Duration interval) {
   core_ensure(impl_.get(), ThreadPoolException() << "thread pool not started");
   impl_->setMaxIdleTime(interval);
@@ -522,6 +619,10 @@ void core::SimpleThreadPool::stop() noexcept { slave_.reset(); }
 
 size_t core::SimpleThreadPool::size() const noexcept { return slave_.get() ? slave_->size() : 0; }
 
+core::ThreadPoolStats core::SimpleThreadPool::stats() const {
+  return slave_.get() ? slave_->stats() : ThreadPoolStats{};
+}
+
 namespace {
 
 class OwnedObjectInQueue : public core::IObjectInQueue {
@@ -540,6 +641,12 @@ class OwnedObjectInQueue : public core::IObjectInQueue {
 
 }  // namespace
 
+core::ThreadPoolStats core::IThreadPool::stats() const {
+  ThreadPoolStats result;
+  result.queue_size = size();
+  return result;
+}
+
 void core::IThreadPool::safeAdd(IObjectInQueue* obj) {
   core_ensure(add(obj), ThreadPoolException() << "can not add object to queue");
 }
@@ -4,10 +4,12 @@
 #include "datetime.h"
 #include "exception.h"
 #include "fwd.h"
+#include "metrics.h"
 #include "noncopyable.h"
 #include "thread_factory.h"
 
 #include <utility>
+#include <vector>
 
 namespace core {
 
@@ -93,12 +95,34 @@ struct ThreadPoolParams {
     return *this;
   }
 
+  // Worker threads are pinned to these CPUs when they start, empty leaves them to the scheduler.
+  ThreadPoolParams& setAffinity(std::vector<size_t> cpus) {
+    affinity = std::move(cpus);
+    return *this;
+  }
+
   bool catching = true;
   bool blocking = false;
 
   IThreadFactory* factory = SystemThreadFactory();
   std::string thread_name;
   bool enumerate_threads = false;
+  std::vector<size_t> affinity;
+};
+
+// Counters of a pool since its start, for sizing its threads and queue.
+struct ThreadPoolStats {
+  size_t threads = 0;
+  size_t queue_size = 0;
+  uint64_t added = 0;
+  // adds refused by a full non-blocking queue
+  uint64_t rejected = 0;
+  uint64_t threads_spawned = 0;
+  // threads of an adaptive pool that exited after the max idle time
+  uint64_t idle_exits = 0;
+  // from add to the start of process, nanoseconds
+  metrics::HistogramSnapshot queue_delay;
+  metrics::HistogramSnapshot execution_time;
 };
 
 class IThreadPool : public IThreadFactory, public NonCopyable {
@@ -135,6 +159,9 @@ class IThreadPool : public IThreadFactory, public NonCopyable {
 
   core_warn_unused_result virtual size_t size() const noexcept = 0;
 
+  // Pools without instrumentation only report the queue size.
+  core_warn_unused_result virtual ThreadPoolStats stats() const;
+
   class Tsr {
    public:
     inline Tsr(IThreadPool* p)
@@ -204,6 +231,7 @@ class ThreadPool : public ThreadPoolBase {
   core_warn_unused_result size_t threadCountExpected() const noexcept;
   core_warn_unused_result size_t threadCountReal() const noexcept;
   core_warn_unused_result size_t maxQueueSize() const noexcept;
+  core_warn_unused_result ThreadPoolStats stats() const override;
 
  private:
   class Impl;
@@ -223,6 +251,7 @@ class AdaptiveThreadPool : public ThreadPoolBase {
   void stop() noexcept override;
 
   core_warn_unused_result size_t size() const noexcept override;
+  core_warn_unused_result ThreadPoolStats stats() const override;
 
  private:
   class Impl;
@@ -239,6 +268,7 @@ class SimpleThreadPool : public ThreadPoolBase {
   void start(size_t thr_num, size_t max_queque_size = 0) override;
   void stop() noexcept override;
   core_warn_unused_result size_t size() const noexcept override;
+  core_warn_unused_result ThreadPoolStats stats() const override;
 
  private:
   std::unique_ptr<IThreadPool> slave_;
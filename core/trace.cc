@@ -0,0 +1,180 @@
+#include "trace.h"
+#include "guard.h"
+#include "mutex.h"
+#include "singleton.h"
+#include "thread.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <limits>
+#include <string_view>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+struct Ring {
+  size_t thread_id = 0;
+  std::string thread_name;
+  // spans ever written, only the owner thread stores it
+  core::Atomic head = 0;
+  core::Atomic in_use = 0;
+  std::array<core::trace::Span, core::trace::kRingSpans> spans;
+};
+
+// Rings of exited threads are handed to new threads, so short lived threads do not grow the registry.
+class Rings : public core::NonCopyable {
+ public:
+  Ring* acquire() noexcept {
+    core_with_lock(lock_) {
+      Ring* ring = nullptr;
+      for (auto* r : rings_) {
+        if (core::atomics::Load(r->in_use) == 0) {
+          ring = r;
+          break;
+        }
+      }
+      if (ring == nullptr) {
+        ring = new (std::nothrow) Ring;
+        if (ring == nullptr) {
+          return nullptr;
+        }
+        rings_.push_back(ring);
+      }
+      ring->thread_id = static_cast<size_t>(syscall(SYS_gettid));
+      ring->thread_name = core::Thread::currentThreadName();
+      core::atomics::Store(ring->head, 0);
+      core::atomics::Store(ring->in_use, 1);
+      return ring;
+    }
+  }
+
+  std::vector<core::trace::ThreadSpans> collect() const {
+    std::vector<core::trace::ThreadSpans> result;
+    core_with_lock(lock_) {
+      for (const auto* ring : rings_) {
+        const auto head = static_cast<size_t>(core::atomics::Load(ring->head));
+        if (head == 0) {
+          continue;
+        }
+        const size_t count = std::min(head, core::trace::kRingSpans);
+        std::vector<core::trace::Span> spans;
+        spans.reserve(count);
+        for (size_t i = head - count; i < head; ++i) {
+          spans.push_back(ring->spans[i % core::trace::kRingSpans]);
+        }
+        // a running owner kept writing during the copy, the slots it may have reused since are dropped
+        const size_t first = head - count;
+        const size_t written = static_cast<size_t>(core::atomics::Load(ring->head)) +
+                               (core::atomics::Load(ring->in_use) != 0 ? 1 : 0);
+        if (written > first + core::trace::kRingSpans) {
+          const auto overwritten = std::min(count, written - first - core::trace::kRingSpans);
+          spans.erase(spans.begin(), spans.begin() + static_cast<std::ptrdiff_t>(overwritten));
+        }
+        result.push_back({ring->thread_id, ring->thread_name, std::move(spans)});
+      }
+    }
+    return result;
+  }
+
+ private:
+  mutable core::Mutex lock_;
+  // never freed, the handles of exiting threads may release their rings after the registry is destroyed at exit
+  std::vector<Ring*> rings_;
+};
+
+struct RingHandle {
+  ~RingHandle() {
+    if (ring != nullptr) {
+      core::atomics::Store(ring->in_use, 0);
+    }
+  }
+
+  Ring* ring = nullptr;
+};
+
+thread_local RingHandle ring_handle;
+
+core::Atomic next_trace_id = 0;
+
+void AppendEscaped(std::string* out, std::string_view value) {
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      *out += '\\';
+    }
+    if (static_cast<unsigned char>(c) >= 0x20) {
+      *out += c;
+    }
+  }
+}
+
+}  // namespace
+
+void core::trace::SetSampling(size_t one_in) noexcept {
+  atomics::Store(detail::sample_one_in, static_cast<AtomicType>(one_in));
+}
+
+uint64_t core::trace::StartTrace() noexcept {
+  static thread_local size_t started = 0;
+  const auto one_in = static_cast<size_t>(atomics::Load(detail::sample_one_in));
+  if (one_in == 0 || ++started % one_in != 0) {
+    return 0;
+  }
+  return static_cast<uint64_t>(atomics::Increment(next_trace_id));
+}
+
+void core::trace::Record(const char* name, uint64_t trace_id, int64_t start_ns, int64_t end_ns) noexcept {
+  auto& handle = ring_handle;
+  if (handle.ring == nullptr) {
+    handle.ring = Singleton<Rings>()->acquire();
+    if (handle.ring == nullptr) {
+      return;
+    }
+  }
+  auto* ring = handle.ring;
+  const auto head = atomics::Load(ring->head);
+  ring->spans[static_cast<size_t>(head) % kRingSpans] = {name, trace_id, start_ns, end_ns};
+  atomics::Store(ring->head, head + 1);
+}
+
+std::vector<core::trace::ThreadSpans> core::trace::Collect() { return Singleton<Rings>()->collect(); }
+
+std::string core::trace::DumpChromeTrace(const std::vector<ThreadSpans>& threads) {
+  int64_t origin = std::numeric_limits<int64_t>::max();
+  for (const auto& thread : threads) {
+    for (const auto& span : thread.spans) {
+      origin = std::min(origin, span.start_ns);
+    }
+  }
+
+  const auto pid = static_cast<long>(getpid());
+  std::string result = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+  char buf[256];
+  for (const auto& thread : threads) {
+    if (!first) {
+      result += ',';
+    }
+    first = false;
+    snprintf(buf, sizeof(buf),
+             "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":%zu,\"args\":{\"name\":\"", pid,
+             thread.thread_id);
+    result += buf;
+    AppendEscaped(&result, thread.thread_name);
+    result += "\"}}";
+    for (const auto& span : thread.spans) {
+      result += ",\n{\"name\":\"";
+      AppendEscaped(&result, span.name);
+      snprintf(buf, sizeof(buf),
+               "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%ld,\"tid\":%zu,\"args\":{\"trace_id\":%llu}}",
+               static_cast<double>(span.start_ns - origin) / 1000,
+               static_cast<double>(std::max<int64_t>(span.end_ns - span.start_ns, 0)) / 1000, pid, thread.thread_id,
+               static_cast<unsigned long long>(span.trace_id));
+      result += buf;
+    }
+  }
+  result += "\n]}\n";
+  return result;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "atomic.h"
+#include "noncopyable.h"
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace core {
+
+namespace trace {
+
+// Spans of a thread kept for a dump, older ones are overwritten.
+inline constexpr size_t kRingSpans = 4096;
+
+struct Span {
+  // a string literal
+  const char* name;
+  uint64_t trace_id;
+  int64_t start_ns;
+  int64_t end_ns;
+};
+
+namespace detail {
+
+inline Atomic sample_one_in = 0;
+
+}  // namespace detail
+
+// Monotonic clock of span bounds.
+inline int64_t Now() noexcept {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// Every thread samples one of `one_in` traces it starts, 0 turns tracing off.
+void SetSampling(size_t one_in) noexcept;
+
+inline bool Enabled() noexcept { return atomics::Load(detail::sample_one_in) != 0; }
+
+// Id of a new sampled trace, 0 if the trace is not sampled. Spans of trace 0 are not recorded.
+uint64_t StartTrace() noexcept;
+
+// Appends the span to the ring of the calling thread.
+void Record(const char* name, uint64_t trace_id, int64_t start_ns, int64_t end_ns) noexcept;
+
+class ScopedSpan : public NonCopyable {
+ public:
+  inline ScopedSpan(const char* name, uint64_t trace_id) noexcept
+      : name_(name)
+      , trace_id_(trace_id)
+      , start_(trace_id == 0 ? 0 : Now()) {}
+
+  inline ~ScopedSpan() {
+    if (trace_id_ != 0) {
+      Record(name_, trace_id_, start_, Now());
+    }
+  }
+
+ private:
+  const char* name_;
+  uint64_t trace_id_;
+  int64_t start_;
+};
+
+struct ThreadSpans {
+  size_t thread_id;
+  std::string thread_name;
+  // oldest first
+  std::vector<Span> spans;
+};
+
+// Spans recorded by every thread, threads that have exited keep theirs until the ring is reused.
+std::vector<ThreadSpans> Collect();
+
+// Chrome trace event format of the spans, opens in chrome://tracing and Perfetto. Timestamps are relative to the
+// oldest span, every span has its trace id in args.
+std::string DumpChromeTrace(const std::vector<ThreadSpans>& threads);
+
+}  // namespace trace
+
+}  // namespace core
@@ -1,4 +1,5 @@
 #include "core/backtrace.h"
+#include "core/backtrace_cache.h"
 
 #include "gtest/gtest.h"
 
@@ -37,4 +38,29 @@ TEST(BackTraceTest, TestBackTrace) {
   ret2 = (*func)(buf2, 100);
 
   ASSERT_EQ(ret1, ret2);
-}
\ No newline at end of file
+}
+
+core_noinline uint64_t CaptureInCache(core::BackTraceCache& cache) {
+  class core::BackTrace bt;
+  bt.capture();
+  return cache.add(bt);
+}
+
+TEST(BackTraceTest, TestCache) {
+  core::BackTraceCache cache;
+  uint64_t hashes[2];
+  // a single call site, an unrolled loop would have two
+  for (volatile size_t i = 0; i < 2; ++i) {
+    hashes[i] = CaptureInCache(cache);
+  }
+  ASSERT_EQ(cache.size(), 1u);
+  ASSERT_EQ(hashes[0], hashes[1]);
+
+  const auto symbolized = cache.symbolize(hashes[0]);
+  // the tests are linked with -rdynamic, the frame has a name
+  ASSERT_FALSE(symbolized.empty());
+  ASSERT_NE(symbolized.find("CaptureInCache"), std::string::npos) << symbolized;
+  // the second call returns the text of the first
+  ASSERT_EQ(cache.symbolize(hashes[0]), symbolized);
+  ASSERT_TRUE(cache.symbolize(hashes[0] + 1).empty());
+}
@@ -0,0 +1,32 @@
+#include "core/cpu_set.h"
+#include "core/exception.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+
+using Cpus = std::vector<size_t>;
+
+TEST(CpuSetTest, TestParseCpuList) {
+  ASSERT_EQ(core::ParseCpuList(""), Cpus());
+  ASSERT_EQ(core::ParseCpuList("3"), Cpus({3}));
+  ASSERT_EQ(core::ParseCpuList("0-3,8"), Cpus({0, 1, 2, 3, 8}));
+  ASSERT_EQ(core::ParseCpuList("10-11,2,2-3\n"), Cpus({2, 3, 10, 11}));
+}
+
+TEST(CpuSetTest, TestParseBadCpuList) {
+  ASSERT_THROW(core::ParseCpuList("a"), core::Exception);
+  ASSERT_THROW(core::ParseCpuList("1,"), core::Exception);
+  ASSERT_THROW(core::ParseCpuList(",1"), core::Exception);
+  ASSERT_THROW(core::ParseCpuList("3-1"), core::Exception);
+  ASSERT_THROW(core::ParseCpuList("1-"), core::Exception);
+  ASSERT_THROW(core::ParseCpuList("-1"), core::Exception);
+}
+
+TEST(CpuSetTest, TestNumaNodes) {
+  ASSERT_GE(core::NumaNodeCount(), 1u);
+  const auto nodes = core::NumaNodes();
+  ASSERT_EQ(nodes.size(), core::NumaNodeCount());
+  ASSERT_TRUE(std::is_sorted(nodes.begin(), nodes.end()));
+  ASSERT_TRUE(core::NumaNodeCpus(1u << 20).empty());
+}
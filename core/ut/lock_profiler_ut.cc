@@ -0,0 +1,103 @@
+#include "core/lock_profiler.h"
+#include "core/mutex.h"
+#include "core/thread.h"
+
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+
+static core::lock_profiler::SiteStats FindSite(int line) {
+  for (const auto& stats : core::lock_profiler::Collect()) {
+    if (stats.location.line == line && stats.location.file == __FILE__) {
+      return stats;
+    }
+  }
+  return {core_source_location};
+}
+
+template <class Lock>
+static void AcquireWhileHeld(Lock& lock, core::lock_profiler::Site& site) {
+  lock.acquire();
+  core::Thread thread([&] {
+    core::lock_profiler::Acquire(&lock, site);
+    lock.release();
+  });
+  thread.start();
+  usleep(50000);
+  lock.release();
+  thread.join();
+}
+
+TEST(LockProfilerTest, TestUncontended) {
+  static core::lock_profiler::Site site(core_source_location);
+  const int line = __LINE__ - 1;
+  core::SpinLock lock;
+  for (size_t i = 0; i < 3; ++i) {
+    core::lock_profiler::Acquire(&lock, site);
+    lock.release();
+  }
+
+  const auto stats = FindSite(line);
+  ASSERT_EQ(stats.acquisitions, 3u);
+  ASSERT_EQ(stats.contended, 0u);
+  ASSERT_EQ(stats.wait_ns, 0u);
+}
+
+TEST(LockProfilerTest, TestContendedSpinLock) {
+  static core::lock_profiler::Site site(core_source_location);
+  const int line = __LINE__ - 1;
+  core::SpinLock lock;
+  AcquireWhileHeld(lock, site);
+
+  const auto stats = FindSite(line);
+  ASSERT_EQ(stats.acquisitions, 1u);
+  ASSERT_EQ(stats.contended, 1u);
+  ASSERT_GT(stats.spins, 0u);
+  ASSERT_GE(stats.wait_ns, 10000000u);
+}
+
+TEST(LockProfilerTest, TestContendedMutex) {
+  static core::lock_profiler::Site site(core_source_location);
+  const int line = __LINE__ - 1;
+  core::Mutex lock;
+  AcquireWhileHeld(lock, site);
+
+  const auto stats = FindSite(line);
+  ASSERT_EQ(stats.contended, 1u);
+  ASSERT_EQ(stats.spins, 0u);
+  ASSERT_GE(stats.wait_ns, 10000000u);
+}
+
+TEST(LockProfilerTest, TestCollectAndReset) {
+  static core::lock_profiler::Site fast(core_source_location);
+  const int fast_line = __LINE__ - 1;
+  static core::lock_profiler::Site slow(core_source_location);
+  const int slow_line = __LINE__ - 1;
+  fast.record(true, 1, 10);
+  slow.record(true, 1, 1000000000);
+
+  const auto stats = core::lock_profiler::Collect();
+  ASSERT_GE(stats.size(), 2u);
+  ASSERT_EQ(stats.front().location.line, slow_line);
+  ASSERT_EQ(FindSite(fast_line).wait_ns, 10u);
+
+  core::lock_profiler::Reset();
+  ASSERT_TRUE(core::lock_profiler::Collect().empty());
+}
+
+TEST(LockProfilerTest, TestWithLock) {
+  core::lock_profiler::Reset();
+  core::AdaptiveLock lock;
+  core_with_lock(lock) { ASSERT_TRUE(lock.isLocked()); }
+  const int line = __LINE__ - 1;
+  ASSERT_FALSE(lock.isLocked());
+
+  const auto report = core::lock_profiler::Format(core::lock_profiler::Collect());
+  if (core::lock_profiler::kEnabled) {
+    ASSERT_EQ(FindSite(line).acquisitions, 1u);
+    ASSERT_NE(report.find("lock_profiler_ut.cc:" + std::to_string(line)), std::string::npos);
+  } else {
+    ASSERT_TRUE(core::lock_profiler::Collect().empty());
+    ASSERT_NE(report.find("disabled"), std::string::npos);
+  }
+}
@@ -0,0 +1,94 @@
+#include "core/metrics.h"
+#include "core/thread.h"
+
+#include "gtest/gtest.h"
+
+#include <vector>
+
+TEST(MetricsTest, TestCounterFromManyThreads) {
+  core::metrics::Counter counter;
+  std::vector<std::unique_ptr<core::Thread>> threads;
+  for (size_t i = 0; i < 8; ++i) {
+    threads.emplace_back(std::make_unique<core::Thread>([&counter]() {
+      for (size_t j = 0; j < 1000; ++j) {
+        counter.inc();
+      }
+    }));
+    threads.back()->start();
+  }
+  for (auto& thread : threads) {
+    thread->join();
+  }
+  ASSERT_EQ(counter.value(), 8000);
+}
+
+TEST(MetricsTest, TestMoreThreadsThanShards) {
+  static constexpr size_t kThreads = 3 * core::metrics::detail::kShards + 1;
+
+  core::metrics::Counter counter;
+  core::metrics::Histogram histogram;
+  // one after another, so that every thread gets a new shard id
+  for (size_t i = 0; i < kThreads; ++i) {
+    core::Thread thread([&counter, &histogram]() {
+      counter.inc();
+      histogram.recordValue(1000);
+    });
+    thread.start();
+    thread.join();
+  }
+  ASSERT_EQ(counter.value(), kThreads);
+  ASSERT_EQ(histogram.snapshot().count, kThreads);
+}
+
+TEST(MetricsTest, TestBuckets) {
+  using core::metrics::Histogram;
+  for (uint64_t value : {0ull, 1ull, 31ull, 32ull, 33ull, 1000ull, 123456789ull, 1ull << 40}) {
+    const auto index = Histogram::bucketIndex(value);
+    ASSERT_LT(index, Histogram::kBuckets);
+    ASSERT_GE(Histogram::bucketUpperBound(index), value);
+    ASSERT_LE(Histogram::bucketUpperBound(index) - value, value / Histogram::kSubBuckets);
+    if (index > 0) {
+      ASSERT_LT(Histogram::bucketUpperBound(index - 1), value);
+    }
+  }
+  ASSERT_EQ(Histogram::bucketIndex(uint64_t(1) << 50), Histogram::kBuckets - 1);
+}
+
+TEST(MetricsTest, TestQuantiles) {
+  core::metrics::Histogram histogram;
+  ASSERT_EQ(histogram.snapshot().valueAtQuantile(0.99), 0u);
+
+  for (uint64_t value = 1; value <= 10000; ++value) {
+    histogram.recordValue(value * 1000);
+  }
+  const auto snapshot = histogram.snapshot();
+  ASSERT_EQ(snapshot.count, 10000u);
+  ASSERT_EQ(snapshot.max, 10000000u);
+  ASSERT_EQ(snapshot.sum, 1000ull * 10000 * 10001 / 2);
+  for (double q : {0.5, 0.9, 0.99, 0.999}) {
+    const double expected = q * 10000000;
+    const auto value = static_cast<double>(snapshot.valueAtQuantile(q));
+    ASSERT_GE(value, expected);
+    ASSERT_LE(value, expected * (1 + 1.0 / core::metrics::Histogram::kSubBuckets));
+  }
+  ASSERT_EQ(snapshot.valueAtQuantile(1), 10000000u);
+}
+
+TEST(MetricsTest, TestRegistry) {
+  auto& registry = core::metrics::Registry::instance();
+  auto& counter = registry.counter("test_calls_total", "method=\"A\"");
+  ASSERT_EQ(&counter, &registry.counter("test_calls_total", "method=\"A\""));
+  ASSERT_NE(&counter, &registry.counter("test_calls_total", "method=\"B\""));
+  counter.inc(3);
+  registry.gauge("test_queue_size").set(7);
+  registry.histogram("test_latency_seconds").record(absl::Milliseconds(2));
+
+  const auto text = core::metrics::DumpPrometheus(registry.collect());
+  ASSERT_NE(text.find("# TYPE test_calls_total counter\n"), std::string::npos);
+  ASSERT_NE(text.find("test_calls_total{method=\"A\"} 3\n"), std::string::npos);
+  ASSERT_NE(text.find("test_calls_total{method=\"B\"} 0\n"), std::string::npos);
+  ASSERT_NE(text.find("test_queue_size 7\n"), std::string::npos);
+  ASSERT_NE(text.find("# TYPE test_latency_seconds summary\n"), std::string::npos);
+  ASSERT_NE(text.find("test_latency_seconds{quantile=\"0.99\"} 0.002\n"), std::string::npos);
+  ASSERT_NE(text.find("test_latency_seconds_count 1\n"), std::string::npos);
+}
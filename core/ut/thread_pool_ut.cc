@@ -1,4 +1,5 @@
 #include "core/condvar.h"
+#include "core/event.h"
 #include "core/mutex.h"
 #include "core/spinlock.h"
 #include "core/thread.h"
@@ -9,6 +10,8 @@
 #include <random>
 #include <unordered_set>
 
+#include <unistd.h>
+
 struct ThreadPoolTest {
   core::SpinLock lock;
   long r = -1;
@@ -157,6 +160,66 @@ TEST(ThreadPoolTest, TestInfoGetters) {
   queue.stop();
 }
 
+template <class Pool, class Predicate>
+static core::ThreadPoolStats WaitForStats(const Pool& pool, Predicate predicate) {
+  auto stats = pool.stats();
+  for (size_t i = 0; i < 1000 && !predicate(stats); ++i) {
+    usleep(1000);
+    stats = pool.stats();
+  }
+  return stats;
+}
+
+TEST(ThreadPoolTest, TestStats) {
+  core::ThreadPool queue;
+  queue.start(1, 1);
+
+  core::ManualEvent started;
+  core::ManualEvent release;
+  ASSERT_TRUE(queue.addFunc([&] {
+    started.signal();
+    release.wait();
+  }));
+  started.wait();
+  ASSERT_TRUE(queue.addFunc([] {}));
+  ASSERT_FALSE(queue.addFunc([] {}));
+
+  auto stats = queue.stats();
+  ASSERT_EQ(stats.threads, 1u);
+  ASSERT_EQ(stats.threads_spawned, 1u);
+  ASSERT_EQ(stats.queue_size, 1u);
+  ASSERT_EQ(stats.added, 2u);
+  ASSERT_EQ(stats.rejected, 1u);
+
+  usleep(20000);
+  release.signal();
+  stats = WaitForStats(queue, [](const auto& s) { return s.execution_time.count == 2; });
+  ASSERT_EQ(stats.execution_time.count, 2u);
+  ASSERT_EQ(stats.queue_delay.count, 2u);
+  ASSERT_EQ(stats.queue_size, 0u);
+  // the first task blocked until released, the second one waited for it in the queue
+  ASSERT_GE(stats.execution_time.max, 20000000u);
+  ASSERT_GE(stats.queue_delay.max, 20000000u);
+
+  queue.stop();
+  ASSERT_EQ(queue.stats().added, 0u);
+}
+
+TEST(ThreadPoolTest, TestAdaptiveStats) {
+  core::AdaptiveThreadPool pool;
+  pool.start();
+  pool.setMaxIdleTime(absl::Milliseconds(10));
+
+  pool.safeAddFunc([] {});
+  const auto stats = WaitForStats(pool, [](const auto& s) { return s.idle_exits == 1; });
+  ASSERT_EQ(stats.added, 1u);
+  ASSERT_EQ(stats.threads_spawned, 1u);
+  ASSERT_EQ(stats.idle_exits, 1u);
+  ASSERT_EQ(stats.execution_time.count, 1u);
+  ASSERT_EQ(stats.queue_delay.count, 1u);
+  pool.stop();
+}
+
 void TestFixedThreadNameImpl(core::IThreadPool& pool, const std::string& expected_name) {
   pool.start(1);
   std::string name;
@@ -216,4 +279,24 @@ TEST(ThreadPoolTest, TestEnumerateThreadName) {
     core::AdaptiveThreadPool pool(core::ThreadPool::Params().setThreadNamePrefix(prefix));
     TestEnumeratedThreadNameImpl(pool, expected_names);
   }
-}
\ No newline at end of file
+}
+
+void TestAffinityImpl(core::IThreadPool& pool, const std::vector<size_t>& expected_cpus) {
+  pool.start(2);
+  std::vector<size_t> cpus;
+  pool.safeAddFunc([&cpus]() { cpus = core::Thread::currentThreadAffinity(); });
+  pool.stop();
+  ASSERT_EQ(cpus, expected_cpus);
+}
+
+TEST(ThreadPoolTest, TestAffinity) {
+  const std::vector<size_t> cpus = {core::Thread::currentThreadAffinity().front()};
+  {
+    core::ThreadPool pool(core::ThreadPool::Params().setAffinity(cpus));
+    TestAffinityImpl(pool, cpus);
+  }
+  {
+    core::AdaptiveThreadPool pool(core::ThreadPool::Params().setAffinity(cpus));
+    TestAffinityImpl(pool, cpus);
+  }
+}
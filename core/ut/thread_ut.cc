@@ -185,3 +185,15 @@ TEST(ThreadTest, TestSetGetThreadNameInChildThread) {
   thread.start();
   thread.join();
 }
+
+TEST(ThreadTest, TestSetCurrentThreadAffinity) {
+  core::Thread thread([]() {
+    auto allowed = core::Thread::currentThreadAffinity();
+    ASSERT_FALSE(allowed.empty());
+    ASSERT_TRUE(core::Thread::setCurrentThreadAffinity({allowed.front()}));
+    ASSERT_EQ(core::Thread::currentThreadAffinity(), std::vector<size_t>({allowed.front()}));
+    ASSERT_FALSE(core::Thread::setCurrentThreadAffinity({}));
+  });
+  thread.start();
+  thread.join();
+}
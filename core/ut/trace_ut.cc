@@ -0,0 +1,83 @@
+#include "core/thread.h"
+#include "core/trace.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstring>
+
+static const core::trace::ThreadSpans* FindThread(const std::vector<core::trace::ThreadSpans>& threads,
+                                                  const char* span_name) {
+  for (const auto& thread : threads) {
+    for (const auto& span : thread.spans) {
+      if (strcmp(span.name, span_name) == 0) {
+        return &thread;
+      }
+    }
+  }
+  return nullptr;
+}
+
+TEST(TraceTest, TestSampling) {
+  core::trace::SetSampling(0);
+  ASSERT_FALSE(core::trace::Enabled());
+  for (size_t i = 0; i < 10; ++i) {
+    ASSERT_EQ(core::trace::StartTrace(), 0u);
+  }
+
+  core::trace::SetSampling(4);
+  ASSERT_TRUE(core::trace::Enabled());
+  std::vector<uint64_t> ids;
+  for (size_t i = 0; i < 100; ++i) {
+    if (auto id = core::trace::StartTrace(); id != 0) {
+      ids.push_back(id);
+    }
+  }
+  ASSERT_EQ(ids.size(), 25u);
+  ASSERT_TRUE(std::adjacent_find(ids.begin(), ids.end(), std::greater_equal<>()) == ids.end());
+  core::trace::SetSampling(0);
+}
+
+TEST(TraceTest, TestScopedSpan) {
+  { core::trace::ScopedSpan span("test.unsampled", 0); }
+  { core::trace::ScopedSpan span("test.scoped", 42); }
+
+  const auto threads = core::trace::Collect();
+  ASSERT_EQ(FindThread(threads, "test.unsampled"), nullptr);
+  const auto* thread = FindThread(threads, "test.scoped");
+  ASSERT_NE(thread, nullptr);
+  const auto& span = thread->spans.back();
+  ASSERT_STREQ(span.name, "test.scoped");
+  ASSERT_EQ(span.trace_id, 42u);
+  ASSERT_LE(span.start_ns, span.end_ns);
+}
+
+TEST(TraceTest, TestRingKeepsLatestSpans) {
+  core::Thread thread([] {
+    for (size_t i = 0; i < core::trace::kRingSpans + 10; ++i) {
+      core::trace::Record(i < 10 ? "test.old" : "test.new", i + 1, static_cast<int64_t>(i), static_cast<int64_t>(i));
+    }
+  });
+  thread.start();
+  thread.join();
+
+  const auto threads = core::trace::Collect();
+  ASSERT_EQ(FindThread(threads, "test.old"), nullptr);
+  const auto* spans = FindThread(threads, "test.new");
+  ASSERT_NE(spans, nullptr);
+  ASSERT_EQ(spans->spans.size(), core::trace::kRingSpans);
+  ASSERT_EQ(spans->spans.front().trace_id, 11u);
+  ASSERT_EQ(spans->spans.back().trace_id, core::trace::kRingSpans + 10);
+}
+
+TEST(TraceTest, TestChromeTrace) {
+  std::vector<core::trace::ThreadSpans> threads = {{7, "worker\"1", {{"DoProcess", 3, 1000, 3500}}},
+                                                   {8, "storage", {{"storage.Store", 3, 2000, 2500}}}};
+  const auto json = core::trace::DumpChromeTrace(threads);
+  ASSERT_EQ(json.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["), 0u);
+  ASSERT_NE(json.find("\"tid\":7,\"args\":{\"name\":\"worker\\\"1\"}}"), std::string::npos);
+  ASSERT_NE(json.find("{\"name\":\"DoProcess\",\"ph\":\"X\",\"ts\":0.000,\"dur\":2.500,"), std::string::npos);
+  ASSERT_NE(json.find("{\"name\":\"storage.Store\",\"ph\":\"X\",\"ts\":1.000,\"dur\":0.500,"), std::string::npos);
+  ASSERT_NE(json.find("\"args\":{\"trace_id\":3}}"), std::string::npos);
+  ASSERT_EQ(json.substr(json.size() - 4), "\n]}\n");
+}
@@ -9,7 +9,7 @@ CREATE TABLE IF NOT EXISTS message_storage(
 );
 
 CREATE INDEX idx__receiver__send_time
-ON message_storage(receiver, send_time);
+ON message_storage(receiver, send_time, id);
 
 CREATE INDEX idx__sender__send_time
 ON message_storage(sender, send_time);
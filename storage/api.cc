@@ -2,6 +2,7 @@
 #include "storage_lock.h"
 
 #include "core/dynlib.h"
+#include "core/metrics.h"
 
 namespace dll_api {
 
@@ -12,6 +13,32 @@ using StorageDestroy = void (*)(storage::IStorage*);
 
 namespace {
 
+class CallMetrics {
+ public:
+  explicit CallMetrics(const char* call)
+      : latency_(core::metrics::Registry::instance().histogram("chat_storage_latency_seconds", Labels(call)))
+      , errors_(core::metrics::Registry::instance().counter("chat_storage_errors_total", Labels(call))) {}
+
+  // Runs the storage call, its latency includes waiting for the storage lock.
+  template <class F>
+  auto operator()(F&& f) {
+    core::metrics::ScopedLatency timer(latency_);
+    try {
+      return f();
+    } catch (...) {
+      errors_.inc();
+      throw;
+    }
+  }
+
+ private:
+  static std::string Labels(const char* call) { return std::string("call=\"") + call + "\""; }
+
+ private:
+  core::metrics::Histogram& latency_;
+  core::metrics::Counter& errors_;
+};
+
 class StorageFromDll final : public storage::IStorage {
  public:
   StorageFromDll(const storage::Config& config)
@@ -31,16 +58,44 @@ class StorageFromDll final : public storage::IStorage {
     dll_.Close();
   }
 
-  void Store(const proto::Message& message) override {
-    core_with_lock(lock_) { storage_->Store(message); }
+  Uids Store(const proto::Message& message) override {
+    return store_([&] {
+      core_with_lock(lock_) { return storage_->Store(message); }
+    });
+  }
+
+  std::vector<bool> StoreBatch(const google::protobuf::RepeatedPtrField<proto::Message>& messages,
+                               std::vector<Uids>* uids = nullptr) override {
+    return store_batch_([&] {
+      core_with_lock(lock_) { return storage_->StoreBatch(messages, uids); }
+    });
   }
 
   std::vector<proto::Message> Load(const std::vector<std::string>& possible_addressees) override {
-    core_with_lock(lock_) { return storage_->Load(possible_addressees); }
+    return load_([&] {
+      core_with_lock(lock_) { return storage_->Load(possible_addressees); }
+    });
+  }
+
+  std::vector<proto::Message> Load(const std::vector<std::string>& possible_addressees, const Cursor& cursor) override {
+    return load_([&] {
+      core_with_lock(lock_) { return storage_->Load(possible_addressees, cursor); }
+    });
   }
 
   std::vector<proto::Message> LoadSended(const std::string& user) override {
-    core_with_lock(lock_) { return storage_->LoadSended(user); }
+    return load_sended_([&] {
+      core_with_lock(lock_) { return storage_->LoadSended(user); }
+    });
+  }
+
+  void LoadInto(const std::vector<std::string>& possible_addressees, const Cursor& cursor,
+                google::protobuf::RepeatedPtrField<proto::Message>* sink) override {
+    load_([&] { core_with_lock(lock_) { storage_->LoadInto(possible_addressees, cursor, sink); } });
+  }
+
+  void LoadSendedInto(const std::string& user, google::protobuf::RepeatedPtrField<proto::Message>* sink) override {
+    load_sended_([&] { core_with_lock(lock_) { storage_->LoadSendedInto(user, sink); } });
   }
 
  private:
@@ -51,6 +106,11 @@ class StorageFromDll final : public storage::IStorage {
   storage::IStorage::LockType type_ = storage::IStorage::LockType::kNone;
   storage::StorageLock lock_;
 
+  CallMetrics store_{"Store"};
+  CallMetrics store_batch_{"StoreBatch"};
+  CallMetrics load_{"Load"};
+  CallMetrics load_sended_{"LoadSended"};
+
   core::DynamicLibrary dll_;
 };
 
@@ -0,0 +1,250 @@
+#include "core/metrics.h"
+#include "storage/api.h"
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/time/clock.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+ABSL_FLAG(std::string, storage_library, "storage/in_memory/libin_memory_storage.so", "Storage DLL to benchmark");
+ABSL_FLAG(std::string, storage_config, "", "Config file passed to the storage DLL");
+ABSL_FLAG(size_t, threads, 4, "Threads calling the storage");
+ABSL_FLAG(double, duration_s, 5, "Measured run time");
+
+ABSL_FLAG(size_t, users, 1000, "Distinct users");
+ABSL_FLAG(size_t, mailbox, 100, "Messages stored for every user before the measurement");
+ABSL_FLAG(size_t, recipients, 1, "Recipients of a written message");
+ABSL_FLAG(size_t, groups, 0, "Groups messages may be addressed to");
+ABSL_FLAG(size_t, group_width, 4, "Groups of every user, a read looks up the user and all of its groups");
+ABSL_FLAG(double, group_ratio, 0.2, "Fraction of recipients that are groups when --groups is set");
+ABSL_FLAG(double, read_ratio, 0.5, "Fraction of reads among all operations");
+ABSL_FLAG(double, sended_ratio, 0.2, "Fraction of LoadSendedInto among reads, the rest are LoadInto");
+ABSL_FLAG(size_t, batch_size, 1, "Messages of a write, more than one writes with StoreBatch instead of Store");
+ABSL_FLAG(size_t, page, 100, "Cursor limit of LoadInto, 0 reads the whole mailbox");
+ABSL_FLAG(size_t, message_bytes, 64, "Message text size");
+
+namespace {
+
+enum class Method { kStore, kStoreBatch, kLoadInto, kLoadSendedInto, kCount };
+
+constexpr std::array<const char*, static_cast<size_t>(Method::kCount)> kMethodNames = {"Store", "StoreBatch",
+                                                                                         "LoadInto", "LoadSendedInto"};
+
+struct Workload {
+  size_t users;
+  size_t recipients;
+  size_t groups;
+  size_t group_width;
+  double group_ratio;
+  double read_ratio;
+  double sended_ratio;
+  size_t batch_size;
+  size_t page;
+  std::string text;
+};
+
+struct Results {
+  std::array<core::metrics::Histogram, static_cast<size_t>(Method::kCount)> latency;
+  std::array<core::metrics::Counter, static_cast<size_t>(Method::kCount)> errors;
+};
+
+std::string UserName(size_t user) { return "bench_user" + std::to_string(user); }
+
+std::string GroupName(size_t group) { return "@bench_group" + std::to_string(group); }
+
+// The user and its groups, like the server expands a login before reading a mailbox.
+std::vector<std::string> Addressees(const Workload& workload, size_t user) {
+  std::vector<std::string> result = {UserName(user)};
+  for (size_t i = 0; i < workload.group_width && i < workload.groups; ++i) {
+    result.push_back(GroupName((user * workload.group_width + i) % workload.groups));
+  }
+  return result;
+}
+
+class Generator {
+ public:
+  Generator(const Workload& workload, uint64_t seed)
+      : workload_(workload)
+      , random_(seed) {}
+
+  size_t User() { return std::uniform_int_distribution<size_t>(0, workload_.users - 1)(random_); }
+
+  bool Chance(double p) { return std::bernoulli_distribution(p)(random_); }
+
+  void FillMessage(proto::Message* message) {
+    message->set_from(UserName(User()));
+    for (size_t i = 0; i < workload_.recipients; ++i) {
+      if (workload_.groups > 0 && Chance(workload_.group_ratio)) {
+        message->add_to(GroupName(std::uniform_int_distribution<size_t>(0, workload_.groups - 1)(random_)));
+      } else {
+        message->add_to(UserName(User()));
+      }
+    }
+    message->set_message(workload_.text);
+    message->set_send_ts(static_cast<uint64_t>(absl::ToUnixSeconds(absl::Now())));
+  }
+
+ private:
+  const Workload& workload_;
+  std::mt19937_64 random_;
+};
+
+// Stores `mailbox` messages for every user, in batches so that slow backends fill up in reasonable time.
+void Prefill(storage::IStorage* storage, const Workload& workload, size_t mailbox) {
+  static constexpr size_t kBatch = 1000;
+  Generator generator(workload, 0);
+  google::protobuf::RepeatedPtrField<proto::Message> batch;
+  for (size_t user = 0; user < workload.users; ++user) {
+    for (size_t i = 0; i < mailbox; ++i) {
+      auto* message = batch.Add();
+      generator.FillMessage(message);
+      message->clear_to();
+      message->add_to(UserName(user));
+      if (static_cast<size_t>(batch.size()) == kBatch) {
+        storage->StoreBatch(batch);
+        batch.Clear();
+      }
+    }
+  }
+  if (!batch.empty()) {
+    storage->StoreBatch(batch);
+  }
+}
+
+void RunThread(storage::IStorage* storage, const Workload& workload, Results* results, uint64_t seed,
+               std::chrono::steady_clock::time_point until) {
+  Generator generator(workload, seed);
+  google::protobuf::RepeatedPtrField<proto::Message> messages;
+  proto::Message message;
+  while (std::chrono::steady_clock::now() < until) {
+    Method method;
+    if (generator.Chance(workload.read_ratio)) {
+      method = generator.Chance(workload.sended_ratio) ? Method::kLoadSendedInto : Method::kLoadInto;
+    } else {
+      method = workload.batch_size > 1 ? Method::kStoreBatch : Method::kStore;
+    }
+
+    // requests are built outside of the measured time
+    messages.Clear();
+    message.Clear();
+    std::vector<std::string> addressees;
+    std::string sender;
+    storage::IStorage::Cursor cursor;
+    switch (method) {
+      case Method::kStore:
+        generator.FillMessage(&message);
+        break;
+      case Method::kStoreBatch:
+        for (size_t i = 0; i < workload.batch_size; ++i) {
+          generator.FillMessage(messages.Add());
+        }
+        break;
+      case Method::kLoadInto:
+        addressees = Addressees(workload, generator.User());
+        cursor.limit = workload.page;
+        break;
+      case Method::kLoadSendedInto:
+        sender = UserName(generator.User());
+        break;
+      default:
+        break;
+    }
+
+    const auto start = absl::Now();
+    try {
+      switch (method) {
+        case Method::kStore:
+          storage->Store(message);
+          break;
+        case Method::kStoreBatch:
+          storage->StoreBatch(messages);
+          break;
+        case Method::kLoadInto:
+          storage->LoadInto(addressees, cursor, &messages);
+          break;
+        case Method::kLoadSendedInto:
+          storage->LoadSendedInto(sender, &messages);
+          break;
+        default:
+          break;
+      }
+      results->latency[static_cast<size_t>(method)].record(absl::Now() - start);
+    } catch (const std::exception&) {
+      results->errors[static_cast<size_t>(method)].inc();
+    }
+  }
+}
+
+}  // namespace
+
+// Runs a synthetic workload against any storage DLL and reports throughput and latency per IStorage method.
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+
+  Workload workload;
+  workload.users = std::max<size_t>(absl::GetFlag(FLAGS_users), 1);
+  workload.recipients = std::max<size_t>(absl::GetFlag(FLAGS_recipients), 1);
+  workload.groups = absl::GetFlag(FLAGS_groups);
+  workload.group_width = absl::GetFlag(FLAGS_group_width);
+  workload.group_ratio = absl::GetFlag(FLAGS_group_ratio);
+  workload.read_ratio = absl::GetFlag(FLAGS_read_ratio);
+  workload.sended_ratio = absl::GetFlag(FLAGS_sended_ratio);
+  workload.batch_size = std::max<size_t>(absl::GetFlag(FLAGS_batch_size), 1);
+  workload.page = absl::GetFlag(FLAGS_page);
+  workload.text = std::string(absl::GetFlag(FLAGS_message_bytes), 'x');
+
+  std::unique_ptr<storage::IStorage> storage;
+  try {
+    storage = storage::CreateStorage({absl::GetFlag(FLAGS_storage_library), absl::GetFlag(FLAGS_storage_config)});
+    const auto prefill_start = std::chrono::steady_clock::now();
+    Prefill(storage.get(), workload, absl::GetFlag(FLAGS_mailbox));
+    std::cout << "prefilled " << workload.users * absl::GetFlag(FLAGS_mailbox) << " messages in "
+              << std::chrono::duration<double>(std::chrono::steady_clock::now() - prefill_start).count() << " s\n";
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+
+  Results results;
+  const auto threads_num = std::max<size_t>(absl::GetFlag(FLAGS_threads), 1);
+  const auto start = std::chrono::steady_clock::now();
+  const auto until =
+      start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                  std::chrono::duration<double>(absl::GetFlag(FLAGS_duration_s)));
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < threads_num; ++i) {
+    threads.emplace_back(RunThread, storage.get(), std::cref(workload), &results, i + 1, until);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::cout << std::left << std::setw(16) << "method" << std::right << std::setw(10) << "ops" << std::setw(8)
+            << "errors" << std::setw(12) << "ops/s" << std::setw(12) << "p50_us" << std::setw(12) << "p99_us"
+            << std::setw(12) << "p999_us" << std::setw(12) << "max_us"
+            << "\n"
+            << std::fixed << std::setprecision(1);
+  for (size_t i = 0; i < static_cast<size_t>(Method::kCount); ++i) {
+    const auto latency = results.latency[i].snapshot();
+    const auto errors = results.errors[i].value();
+    if (latency.count == 0 && errors == 0) {
+      continue;
+    }
+    const auto us = [&](double q) { return static_cast<double>(latency.valueAtQuantile(q)) / 1000; };
+    std::cout << std::left << std::setw(16) << kMethodNames[i] << std::right << std::setw(10) << latency.count
+              << std::setw(8) << errors << std::setw(12) << static_cast<double>(latency.count) / seconds
+              << std::setw(12) << us(0.5) << std::setw(12) << us(0.99) << std::setw(12) << us(0.999) << std::setw(12)
+              << static_cast<double>(latency.max) / 1000 << "\n";
+  }
+  return 0;
+}
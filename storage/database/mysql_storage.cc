@@ -6,6 +6,21 @@
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
 
+static void MessageFromRow(const mysqlpp::Row& row, proto::Message* message) {
+  message->set_message_uid(row["id"]);
+  message->set_from(row["sender"]);
+  const auto& all_receivers = row["all_receivers"];
+  for (auto to : absl::StrSplit(std::string_view(all_receivers.data(), all_receivers.length()), ';')) {
+    message->add_to(to.data(), to.size());
+  }
+  message->set_send_ts(row["send_time"]);
+  message->set_message(row["message"]);
+  const auto& reply = row["reply"];
+  if (!reply.is_null()) {
+    message->add_reply(reply);
+  }
+}
+
 storage::database::MySqlStorage* storage::database::MySqlStorage::Create(const storage::database::Config& config) {
   MySqlStorage* r = nullptr;
   try {
@@ -21,10 +36,8 @@ storage::database::MySqlStorage::MySqlStorage(const database::Config& config)
                                       config.password.c_str(), config.port))
     , table_(config.table) {}
 
-void storage::database::MySqlStorage::Store(const proto::Message& message) {
-  auto& connection = core::TlsRef(connection_);
-  auto query = connection.query();
-  query << "INSERT INTO " << table_ << "(sender, receiver, all_receivers, send_time, message, reply) "
+static void InsertQuery(mysqlpp::Query& query, const std::string& table, const proto::Message& message) {
+  query << "INSERT INTO " << table << "(sender, receiver, all_receivers, send_time, message, reply) "
         << "VALUES ";
   const auto to_all = absl::StrJoin(message.to(), ";");
   for (size_t i = 0; i < message.to().size(); ++i) {
@@ -40,9 +53,27 @@ void storage::database::MySqlStorage::Store(const proto::Message& message) {
     }
   }
   query << ";";
+}
+
+// The rows of one multi-row insert get consecutive ids starting at the one reported for the statement.
+static storage::IStorage::Uids InsertedUids(const mysqlpp::SimpleResult& result, const proto::Message& message) {
+  storage::IStorage::Uids uids;
+  uids.reserve(message.to_size());
+  for (int i = 0; i < message.to_size(); ++i) {
+    uids.push_back(result.insert_id() + static_cast<uint64_t>(i));
+  }
+  return uids;
+}
+
+storage::IStorage::Uids storage::database::MySqlStorage::Store(const proto::Message& message) {
+  auto& connection = core::TlsRef(connection_);
+  auto query = connection.query();
+  InsertQuery(query, table_, message);
   mysqlpp::Transaction txn(connection);
+  Uids uids;
   try {
-    if (query.execute()) {
+    if (const auto result = query.execute()) {
+      uids = InsertedUids(result, message);
       txn.commit();
     }
   } catch (const mysqlpp::BadQuery& e) {
@@ -52,6 +83,49 @@ void storage::database::MySqlStorage::Store(const proto::Message& message) {
   } catch (const mysqlpp::Exception& e) {
     core_throw core::Exception() << e.what() << "\n Query was: " << query.str();
   }
+  return uids;
+}
+
+std::vector<bool> storage::database::MySqlStorage::StoreBatch(
+    const google::protobuf::RepeatedPtrField<proto::Message>& messages, std::vector<Uids>* uids) {
+  auto& connection = core::TlsRef(connection_);
+  std::vector<bool> result;
+  std::vector<Uids> stored;
+  result.reserve(messages.size());
+  stored.reserve(messages.size());
+  mysqlpp::Transaction txn(connection);
+  try {
+    for (const auto& message : messages) {
+      if (message.to().empty()) {
+        stored.emplace_back();
+        result.push_back(true);
+        continue;
+      }
+      // a savepoint per message drops only the failed one from the single commit
+      connection.query("SAVEPOINT batch_message;").execute();
+      auto query = connection.query();
+      InsertQuery(query, table_, message);
+      try {
+        stored.push_back(InsertedUids(query.execute(), message));
+        result.push_back(true);
+      } catch (const mysqlpp::BadQuery&) {
+        connection.query("ROLLBACK TO SAVEPOINT batch_message;").execute();
+        stored.emplace_back();
+        result.push_back(false);
+      }
+    }
+    txn.commit();
+  } catch (const mysqlpp::BadQuery& e) {
+    core_throw core::Exception() << e.what();
+  } catch (const mysqlpp::BadConversion& e) {
+    core_throw core::Exception() << e.what();
+  } catch (const mysqlpp::Exception& e) {
+    core_throw core::Exception() << e.what();
+  }
+  if (uids != nullptr) {
+    *uids = std::move(stored);
+  }
+  return result;
 }
 
 std::vector<proto::Message> storage::database::MySqlStorage::Load(const std::vector<std::string>& possible_addressees) {
@@ -65,18 +139,38 @@ std::vector<proto::Message> storage::database::MySqlStorage::Load(const std::vec
             << "FROM " << table_ << " WHERE receiver = '" << to << "' AND send_time <= " << now << ";";
       auto res = query.store();
       for (size_t i = 0; i < res.num_rows(); ++i) {
-        proto::Message message;
-        message.set_message_uid(res[i]["id"]);
-        message.set_from(res[i]["sender"]);
-        auto split_to = absl::StrSplit(std::string(res[i]["all_receivers"]), ';');
-        *message.mutable_to() = {split_to.begin(), split_to.end()};
-        message.set_send_ts(res[i]["send_time"]);
-        message.set_message(res[i]["message"]);
-        const auto& reply = res[i]["reply"];
-        if (!reply.is_null()) {
-          message.add_reply(reply);
-        }
-        result.push_back(std::move(message));
+        MessageFromRow(res[i], &result.emplace_back());
+      }
+    }
+  } catch (const mysqlpp::BadQuery& e) {
+    core_throw core::Exception() << e.what();
+  } catch (const mysqlpp::BadConversion& e) {
+    core_throw core::Exception() << e.what();
+  } catch (const mysqlpp::Exception& e) {
+    core_throw core::Exception() << e.what();
+  }
+  return result;
+}
+
+std::vector<proto::Message> storage::database::MySqlStorage::Load(const std::vector<std::string>& possible_addressees,
+                                                                 const Cursor& cursor) {
+  auto& connection = core::TlsRef(connection_);
+  std::vector<proto::Message> result;
+  auto now = absl::ToUnixSeconds(absl::Now());
+  try {
+    for (const auto& to : possible_addressees) {
+      auto query = connection.query();
+      query << "SELECT id, sender, all_receivers, send_time, message, reply "
+            << "FROM " << table_ << " WHERE receiver = '" << to << "' AND send_time <= " << now
+            << " AND (send_time > " << cursor.after_ts << " OR (send_time = " << cursor.after_ts
+            << " AND id > " << cursor.after_uid << ")) ORDER BY send_time, id";
+      if (cursor.limit != 0) {
+        query << " LIMIT " << cursor.limit;
+      }
+      query << ";";
+      auto res = query.store();
+      for (size_t i = 0; i < res.num_rows(); ++i) {
+        MessageFromRow(res[i], &result.emplace_back());
       }
     }
   } catch (const mysqlpp::BadQuery& e) {
@@ -86,6 +180,7 @@ std::vector<proto::Message> storage::database::MySqlStorage::Load(const std::vec
   } catch (const mysqlpp::Exception& e) {
     core_throw core::Exception() << e.what();
   }
+  SortAndTruncate(result, cursor.limit);
   return result;
 }
 
@@ -99,18 +194,7 @@ std::vector<proto::Message> storage::database::MySqlStorage::LoadSended(const st
           << "FROM " << table_ << " WHERE sender = '" << user << "' AND send_time <= " << now << ";";
     auto res = query.store();
     for (size_t i = 0; i < res.num_rows(); ++i) {
-      proto::Message message;
-      message.set_message_uid(res[i]["id"]);
-      message.set_from(res[i]["sender"]);
-      auto split_to = absl::StrSplit(std::string(res[i]["all_receivers"]), ';');
-      *message.mutable_to() = {split_to.begin(), split_to.end()};
-      message.set_send_ts(res[i]["send_time"]);
-      message.set_message(res[i]["message"]);
-      const auto& reply = res[i]["reply"];
-      if (!reply.is_null()) {
-        message.add_reply(reply);
-      }
-      result.push_back(std::move(message));
+      MessageFromRow(res[i], &result.emplace_back());
     }
   } catch (const mysqlpp::BadQuery& e) {
     core_throw core::Exception() << e.what();
@@ -121,3 +205,58 @@ std::vector<proto::Message> storage::database::MySqlStorage::LoadSended(const st
   }
   return result;
 }
+
+void storage::database::MySqlStorage::LoadInto(const std::vector<std::string>& possible_addressees,
+                                               const Cursor& cursor,
+                                               google::protobuf::RepeatedPtrField<proto::Message>* sink) {
+  auto& connection = core::TlsRef(connection_);
+  const int from = sink->size();
+  auto now = absl::ToUnixSeconds(absl::Now());
+  try {
+    for (const auto& to : possible_addressees) {
+      auto query = connection.query();
+      query << "SELECT id, sender, all_receivers, send_time, message, reply "
+            << "FROM " << table_ << " WHERE receiver = '" << to << "' AND send_time <= " << now
+            << " AND (send_time > " << cursor.after_ts << " OR (send_time = " << cursor.after_ts
+            << " AND id > " << cursor.after_uid << ")) ORDER BY send_time, id";
+      if (cursor.limit != 0) {
+        query << " LIMIT " << cursor.limit;
+      }
+      query << ";";
+      auto res = query.store();
+      sink->Reserve(sink->size() + static_cast<int>(res.num_rows()));
+      for (size_t i = 0; i < res.num_rows(); ++i) {
+        MessageFromRow(res[i], sink->Add());
+      }
+    }
+  } catch (const mysqlpp::BadQuery& e) {
+    core_throw core::Exception() << e.what();
+  } catch (const mysqlpp::BadConversion& e) {
+    core_throw core::Exception() << e.what();
+  } catch (const mysqlpp::Exception& e) {
+    core_throw core::Exception() << e.what();
+  }
+  SortAndTruncate(sink, from, cursor.limit);
+}
+
+void storage::database::MySqlStorage::LoadSendedInto(const std::string& user,
+                                                     google::protobuf::RepeatedPtrField<proto::Message>* sink) {
+  auto& connection = core::TlsRef(connection_);
+  auto now = absl::ToUnixSeconds(absl::Now());
+  try {
+    auto query = connection.query();
+    query << "SELECT id, sender, all_receivers, send_time, message, reply "
+          << "FROM " << table_ << " WHERE sender = '" << user << "' AND send_time <= " << now << ";";
+    auto res = query.store();
+    sink->Reserve(sink->size() + static_cast<int>(res.num_rows()));
+    for (size_t i = 0; i < res.num_rows(); ++i) {
+      MessageFromRow(res[i], sink->Add());
+    }
+  } catch (const mysqlpp::BadQuery& e) {
+    core_throw core::Exception() << e.what();
+  } catch (const mysqlpp::BadConversion& e) {
+    core_throw core::Exception() << e.what();
+  } catch (const mysqlpp::Exception& e) {
+    core_throw core::Exception() << e.what();
+  }
+}
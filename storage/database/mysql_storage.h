@@ -13,12 +13,22 @@ class MySqlStorage final : public IStorage {
  public:
   static MySqlStorage* Create(const database::Config& config);
 
-  void Store(const proto::Message& message) override;
+  Uids Store(const proto::Message& message) override;
+
+  std::vector<bool> StoreBatch(const google::protobuf::RepeatedPtrField<proto::Message>& messages,
+                               std::vector<Uids>* uids = nullptr) override;
 
   std::vector<proto::Message> Load(const std::vector<std::string>& possible_addressees) override;
 
+  std::vector<proto::Message> Load(const std::vector<std::string>& possible_addressees, const Cursor& cursor) override;
+
   std::vector<proto::Message> LoadSended(const std::string& user) override;
 
+  void LoadInto(const std::vector<std::string>& possible_addressees, const Cursor& cursor,
+                google::protobuf::RepeatedPtrField<proto::Message>* sink) override;
+
+  void LoadSendedInto(const std::string& user, google::protobuf::RepeatedPtrField<proto::Message>* sink) override;
+
  private:
   MySqlStorage(const database::Config& config);
 
@@ -18,23 +18,43 @@ static auto ConnectionString(const storage::database::Config& config) {
   return out.str();
 }
 
+static void MessageFromRow(const pqxx::row& row, proto::Message* message) {
+  message->set_message_uid(row[0].get<uint64_t>().value());
+  message->set_from(row[1].get<std::string>().value());
+  for (auto to : absl::StrSplit(std::string_view(row[2].c_str(), row[2].size()), ';')) {
+    message->add_to(to.data(), to.size());
+  }
+  message->set_send_ts(row[3].get<uint64_t>().value());
+  message->set_message(row[4].get<std::string>().value());
+  const auto& reply = row[5].get<std::string>();
+  if (reply.has_value()) {
+    message->add_reply(reply.value());
+  }
+}
+
 storage::database::detail::ConnectionWrapper::ConnectionWrapper(const database::Config& config)
     : connection_(ConnectionString(config)) {
-  std::ostringstream ins, sel, sel_send;
+  std::ostringstream ins, sel, sel_cursor, sel_send;
 
   ins << "INSERT INTO " << config.table << " (sender, receiver, all_receivers, send_time, message, reply) "
-      << "VALUES ($1,$2,$3,$4,$5, $6);";
+      << "VALUES ($1,$2,$3,$4,$5, $6) RETURNING id;";
 
   sel << "SELECT id, sender, all_receivers, send_time, message, reply "
       << "FROM " << config.table << " "
       << "WHERE receiver = $1 AND send_time <= $2;";
 
+  sel_cursor << "SELECT id, sender, all_receivers, send_time, message, reply "
+             << "FROM " << config.table << " "
+             << "WHERE receiver = $1 AND send_time <= $2 AND (send_time, id) > ($3, $4) "
+             << "ORDER BY send_time, id LIMIT $5;";
+
   sel_send << "SELECT id, sender, all_receivers, send_time, message, reply "
            << "FROM " << config.table << " "
            << "WHERE sender = $1 AND send_time <= $2;";
 
   connection_.prepare("insert_query", ins.str());
   connection_.prepare("select_query", sel.str());
+  connection_.prepare("select_cursor_query", sel_cursor.str());
   connection_.prepare("select_sended_query", sel_send.str());
 }
 
@@ -54,16 +74,61 @@ storage::database::PostgreSqlStorage* storage::database::PostgreSqlStorage::Crea
   return r;
 }
 
-void storage::database::PostgreSqlStorage::Store(const proto::Message& message) {
+// a row per addressee, the ids of the rows are the uids
+static storage::IStorage::Uids InsertMessage(pqxx::transaction_base& txn, const proto::Message& message) {
+  storage::IStorage::Uids uids;
+  uids.reserve(message.to_size());
+  const auto to_all = absl::StrJoin(message.to(), ";");
+  for (const auto& to : message.to()) {
+    pqxx::result res;
+    if (message.reply_size() == 1) {
+      res = txn.exec_prepared("insert_query", message.from(), to, to_all, message.send_ts(), message.message(),
+                              message.reply(0));
+    } else {
+      res = txn.exec_prepared("insert_query", message.from(), to, to_all, message.send_ts(), message.message(),
+                              nullptr);
+    }
+    uids.push_back(res[0][0].get<uint64_t>().value());
+  }
+  return uids;
+}
+
+storage::IStorage::Uids storage::database::PostgreSqlStorage::Store(const proto::Message& message) {
   pqxx::work txn{core::TlsRef(connection_)()};
+  Uids uids;
   try {
-    const auto to_all = absl::StrJoin(message.to(), ";");
-    for (const auto& to : message.to()) {
-      if (message.reply_size() == 1) {
-        txn.exec_prepared("insert_query", message.from(), to, to_all, message.send_ts(), message.message(),
-                          message.reply(0));
-      } else {
-        txn.exec_prepared("insert_query", message.from(), to, to_all, message.send_ts(), message.message(), nullptr);
+    uids = InsertMessage(txn, message);
+    txn.commit();
+  } catch (const pqxx::sql_error& e) {
+    txn.abort();
+    core_throw core::Exception() << "SQL error: " << e.what() << "\nQuery was: " << e.query();
+  } catch (const std::exception& e) {
+    txn.abort();
+    core_throw core::Exception() << e.what();
+  }
+  return uids;
+}
+
+std::vector<bool> storage::database::PostgreSqlStorage::StoreBatch(
+    const google::protobuf::RepeatedPtrField<proto::Message>& messages, std::vector<Uids>* uids) {
+  std::vector<bool> result;
+  std::vector<Uids> stored;
+  result.reserve(messages.size());
+  stored.reserve(messages.size());
+  pqxx::work txn{core::TlsRef(connection_)()};
+  try {
+    for (const auto& message : messages) {
+      // a savepoint per message drops only the failed one from the single commit
+      pqxx::subtransaction sub{txn};
+      try {
+        auto message_uids = InsertMessage(sub, message);
+        sub.commit();
+        stored.push_back(std::move(message_uids));
+        result.push_back(true);
+      } catch (const pqxx::sql_error&) {
+        sub.abort();
+        stored.emplace_back();
+        result.push_back(false);
       }
     }
     txn.commit();
@@ -74,6 +139,10 @@ void storage::database::PostgreSqlStorage::Store(const proto::Message& message)
     txn.abort();
     core_throw core::Exception() << e.what();
   }
+  if (uids != nullptr) {
+    *uids = std::move(stored);
+  }
+  return result;
 }
 
 std::vector<proto::Message> storage::database::PostgreSqlStorage::Load(
@@ -86,18 +155,7 @@ std::vector<proto::Message> storage::database::PostgreSqlStorage::Load(
     for (const auto& to : possible_addressees) {
       auto res = txn.exec_prepared("select_query", to, now);
       for (const auto& row : res) {
-        proto::Message message;
-        message.set_message_uid(row[0].get<uint64_t>().value());
-        message.set_from(row[1].get<std::string>().value());
-        auto splitted_to = absl::StrSplit(row[2].get<std::string>().value(), ';');
-        *message.mutable_to() = {splitted_to.begin(), splitted_to.end()};
-        message.set_send_ts(row[3].get<uint64_t>().value());
-        message.set_message(row[4].get<std::string>().value());
-        const auto& reply = row[5].get<std::string>();
-        if (reply.has_value()) {
-          message.add_reply(reply.value());
-        }
-        result.push_back(std::move(message));
+        MessageFromRow(row, &result.emplace_back());
       }
     }
     txn.commit();
@@ -111,6 +169,36 @@ std::vector<proto::Message> storage::database::PostgreSqlStorage::Load(
   return result;
 }
 
+std::vector<proto::Message> storage::database::PostgreSqlStorage::Load(
+    const std::vector<std::string>& possible_addressees, const Cursor& cursor) {
+  std::vector<proto::Message> result;
+  auto now = absl::ToUnixSeconds(absl::Now());
+  pqxx::work txn{core::TlsRef(connection_)()};
+
+  try {
+    for (const auto& to : possible_addressees) {
+      pqxx::result res;
+      if (cursor.limit != 0) {
+        res = txn.exec_prepared("select_cursor_query", to, now, cursor.after_ts, cursor.after_uid, cursor.limit);
+      } else {
+        res = txn.exec_prepared("select_cursor_query", to, now, cursor.after_ts, cursor.after_uid, nullptr);
+      }
+      for (const auto& row : res) {
+        MessageFromRow(row, &result.emplace_back());
+      }
+    }
+    txn.commit();
+  } catch (const pqxx::sql_error& e) {
+    txn.abort();
+    core_throw core::Exception() << "SQL error: " << e.what() << "\nQuery was: " << e.query();
+  } catch (const std::exception& e) {
+    txn.abort();
+    core_throw core::Exception() << e.what();
+  }
+  SortAndTruncate(result, cursor.limit);
+  return result;
+}
+
 std::vector<proto::Message> storage::database::PostgreSqlStorage::LoadSended(const std::string& user) {
   std::vector<proto::Message> result;
   auto now = absl::ToUnixSeconds(absl::Now());
@@ -119,18 +207,7 @@ std::vector<proto::Message> storage::database::PostgreSqlStorage::LoadSended(con
   try {
     auto res = txn.exec_prepared("select_sended_query", user, now);
     for (const auto& row : res) {
-      proto::Message message;
-      message.set_message_uid(row[0].get<uint64_t>().value());
-      message.set_from(row[1].get<std::string>().value());
-      auto splitted_to = absl::StrSplit(row[2].get<std::string>().value(), ';');
-      *message.mutable_to() = {splitted_to.begin(), splitted_to.end()};
-      message.set_send_ts(row[3].get<uint64_t>().value());
-      message.set_message(row[4].get<std::string>().value());
-      const auto& reply = row[5].get<std::string>();
-      if (reply.has_value()) {
-        message.add_reply(reply.value());
-      }
-      result.push_back(std::move(message));
+      MessageFromRow(row, &result.emplace_back());
     }
     txn.commit();
   } catch (const pqxx::sql_error& e) {
@@ -142,3 +219,55 @@ std::vector<proto::Message> storage::database::PostgreSqlStorage::LoadSended(con
   }
   return result;
 }
+
+void storage::database::PostgreSqlStorage::LoadInto(const std::vector<std::string>& possible_addressees,
+                                                    const Cursor& cursor,
+                                                    google::protobuf::RepeatedPtrField<proto::Message>* sink) {
+  const int from = sink->size();
+  auto now = absl::ToUnixSeconds(absl::Now());
+  pqxx::work txn{core::TlsRef(connection_)()};
+
+  try {
+    for (const auto& to : possible_addressees) {
+      pqxx::result res;
+      if (cursor.limit != 0) {
+        res = txn.exec_prepared("select_cursor_query", to, now, cursor.after_ts, cursor.after_uid, cursor.limit);
+      } else {
+        res = txn.exec_prepared("select_cursor_query", to, now, cursor.after_ts, cursor.after_uid, nullptr);
+      }
+      sink->Reserve(sink->size() + static_cast<int>(res.size()));
+      for (const auto& row : res) {
+        MessageFromRow(row, sink->Add());
+      }
+    }
+    txn.commit();
+  } catch (const pqxx::sql_error& e) {
+    txn.abort();
+    core_throw core::Exception() << "SQL error: " << e.what() << "\nQuery was: " << e.query();
+  } catch (const std::exception& e) {
+    txn.abort();
+    core_throw core::Exception() << e.what();
+  }
+  SortAndTruncate(sink, from, cursor.limit);
+}
+
+void storage::database::PostgreSqlStorage::LoadSendedInto(const std::string& user,
+                                                          google::protobuf::RepeatedPtrField<proto::Message>* sink) {
+  auto now = absl::ToUnixSeconds(absl::Now());
+  pqxx::work txn{core::TlsRef(connection_)()};
+
+  try {
+    auto res = txn.exec_prepared("select_sended_query", user, now);
+    sink->Reserve(sink->size() + static_cast<int>(res.size()));
+    for (const auto& row : res) {
+      MessageFromRow(row, sink->Add());
+    }
+    txn.commit();
+  } catch (const pqxx::sql_error& e) {
+    txn.abort();
+    core_throw core::Exception() << "SQL error: " << e.what() << "\nQuery was: " << e.query();
+  } catch (const std::exception& e) {
+    txn.abort();
+    core_throw core::Exception() << e.what();
+  }
+}
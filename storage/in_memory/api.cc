@@ -1,11 +1,34 @@
 #include "api.h"
 #include "in_memory_storage.h"
 
-#include "core/macro.h"
+#include "core/exception.h"
+#include "inicpp/inicpp.h"
+
+#include <filesystem>
+
+namespace {
+
+storage::InMemoryStorage::Options LoadOptions(const char* filename) {
+  storage::InMemoryStorage::Options result;
+  // the storage needs no config, a missing one means the defaults
+  if (filename == nullptr || !std::filesystem::exists(filename)) {
+    return result;
+  }
+  try {
+    auto config = inicpp::parser::load_file(filename);
+    if (config.contains("in_memory") && config["in_memory"].contains("huge_pages")) {
+      result.huge_pages = config["in_memory"]["huge_pages"].get<bool>();
+    }
+  } catch (const std::exception& e) {
+    core_throw core::Exception() << e.what();
+  }
+  return result;
+}
+
+}  // namespace
 
 extern "C" storage::IStorage* CreateStorage(const char* storage_config) {
-  core_ignore_result(storage_config);
-  return new storage::InMemoryStorage();
+  return new storage::InMemoryStorage(LoadOptions(storage_config));
 }
 
 extern "C" void DestroyStorage(storage::IStorage* storage) { delete static_cast<storage::InMemoryStorage*>(storage); }
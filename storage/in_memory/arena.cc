@@ -0,0 +1,62 @@
+#include "arena.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include <sys/mman.h>
+
+storage::Arena::Arena(bool huge_pages) noexcept
+    : huge_pages_(huge_pages)
+    , slab_size_(huge_pages ? kHugeSlabSize : kSlabSize) {}
+
+storage::Arena::~Arena() {
+  for (auto* slab : slabs_) {
+    free(slab);
+  }
+}
+
+void* storage::Arena::Allocate(size_t size, size_t align) {
+  const auto aligned = (reinterpret_cast<uintptr_t>(pos_) + align - 1) & ~(uintptr_t(align) - 1);
+  if (pos_ != nullptr && aligned + size <= reinterpret_cast<uintptr_t>(end_)) {
+    pos_ = reinterpret_cast<char*>(aligned + size);
+    return reinterpret_cast<void*>(aligned);
+  }
+  // a large block gets a slab of its own, the current slab keeps serving small ones
+  if (size > slab_size_ / 8) {
+    return NewSlab(size, align);
+  }
+  auto* p = static_cast<char*>(NewSlab(slab_size_, align));
+  pos_ = p + size;
+  end_ = p + slab_size_;
+  return p;
+}
+
+std::string_view storage::Arena::Copy(std::string_view s) {
+  if (s.empty()) {
+    return {};
+  }
+  auto* p = static_cast<char*>(Allocate(s.size(), 1));
+  memcpy(p, s.data(), s.size());
+  return {p, s.size()};
+}
+
+void* storage::Arena::NewSlab(size_t size, size_t align) {
+  const size_t slab_align = huge_pages_ && size == slab_size_ ? kHugeSlabSize : std::max(align, alignof(std::max_align_t));
+  const size_t rounded = (size + slab_align - 1) / slab_align * slab_align;
+  // the slot is taken before the allocation, a vector that fails to grow leaks nothing
+  slabs_.push_back(nullptr);
+  void* slab = aligned_alloc(slab_align, rounded);
+  if (slab == nullptr) {
+    slabs_.pop_back();
+    throw std::bad_alloc();
+  }
+  if (huge_pages_ && size == slab_size_) {
+    madvise(slab, rounded, MADV_HUGEPAGE);
+  }
+  slabs_.back() = slab;
+  reserved_ += rounded;
+  return slab;
+}
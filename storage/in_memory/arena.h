@@ -0,0 +1,48 @@
+#pragma once
+
+#include "core/noncopyable.h"
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace storage {
+
+// Bump allocator for data that lives as long as the storage, nothing is freed before the arena is destroyed. Not
+// thread safe, every user locks its own arena.
+class Arena : public core::NonCopyable {
+ public:
+  static constexpr size_t kSlabSize = size_t(256) << 10;
+  // the size of a transparent huge page on x86-64
+  static constexpr size_t kHugeSlabSize = size_t(2) << 20;
+
+  // With huge_pages the slabs are huge page aligned and advised to the kernel as MADV_HUGEPAGE.
+  explicit Arena(bool huge_pages = false) noexcept;
+  ~Arena();
+
+  // Throws std::bad_alloc.
+  void* Allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+  template <class T>
+  inline T* AllocateArray(size_t count) {
+    return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+  }
+
+  std::string_view Copy(std::string_view s);
+
+  // Bytes of all slabs.
+  inline size_t Reserved() const noexcept { return reserved_; }
+
+ private:
+  void* NewSlab(size_t size, size_t align);
+
+ private:
+  const bool huge_pages_;
+  const size_t slab_size_;
+  std::vector<void*> slabs_;
+  char* pos_ = nullptr;
+  char* end_ = nullptr;
+  size_t reserved_ = 0;
+};
+
+}  // namespace storage
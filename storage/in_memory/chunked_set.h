@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace storage {
+
+// A sorted set kept in arrays of at most kChunk elements. Timelines mostly grow at their end, so an insert usually
+// appends to the last chunk, and a range scan walks contiguous memory instead of tree nodes.
+template <class T, class Compare, size_t kChunk = 256>
+class ChunkedSet {
+  using Chunk = std::vector<T>;
+
+ public:
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T*;
+    using reference = const T&;
+
+    const_iterator() = default;
+
+    inline reference operator*() const noexcept { return (*chunks_)[chunk_][pos_]; }
+    inline pointer operator->() const noexcept { return &**this; }
+
+    inline const_iterator& operator++() noexcept {
+      if (++pos_ == (*chunks_)[chunk_].size()) {
+        ++chunk_;
+        pos_ = 0;
+      }
+      return *this;
+    }
+
+    inline bool operator==(const const_iterator& other) const noexcept {
+      return chunk_ == other.chunk_ && pos_ == other.pos_;
+    }
+
+    inline bool operator!=(const const_iterator& other) const noexcept { return !(*this == other); }
+
+   private:
+    friend class ChunkedSet;
+
+    inline const_iterator(const std::vector<Chunk>* chunks, size_t chunk, size_t pos) noexcept
+        : chunks_(chunks)
+        , chunk_(chunk)
+        , pos_(pos) {}
+
+   private:
+    const std::vector<Chunk>* chunks_ = nullptr;
+    size_t chunk_ = 0;
+    size_t pos_ = 0;
+  };
+
+  inline const_iterator begin() const noexcept { return {&chunks_, 0, 0}; }
+  inline const_iterator end() const noexcept { return {&chunks_, chunks_.size(), 0}; }
+
+  inline size_t size() const noexcept { return size_; }
+  inline bool empty() const noexcept { return size_ == 0; }
+
+  // Returns false and keeps the set unchanged if an equivalent element is present.
+  bool insert(T value) {
+    if (chunks_.empty() || !less_(value, chunks_.back().back())) {
+      if (!chunks_.empty() && !less_(chunks_.back().back(), value)) {
+        return false;
+      }
+      // appends leave full chunks behind instead of splitting them
+      if (chunks_.empty() || chunks_.back().size() == kChunk) {
+        chunks_.emplace_back().reserve(kChunk);
+      }
+      chunks_.back().push_back(std::move(value));
+      ++size_;
+      return true;
+    }
+
+    const auto c = static_cast<size_t>(FirstChunkNotBelow(value) - chunks_.begin());
+    auto& chunk = chunks_[c];
+    const auto pos = std::lower_bound(chunk.begin(), chunk.end(), value, less_);
+    if (!less_(value, *pos)) {
+      return false;
+    }
+    chunk.insert(pos, std::move(value));
+    ++size_;
+    if (chunk.size() > kChunk) {
+      Chunk upper;
+      upper.reserve(kChunk);
+      const auto half = chunk.begin() + static_cast<std::ptrdiff_t>(chunk.size() / 2);
+      upper.assign(std::make_move_iterator(half), std::make_move_iterator(chunk.end()));
+      chunk.erase(half, chunk.end());
+      chunks_.insert(chunks_.begin() + static_cast<std::ptrdiff_t>(c) + 1, std::move(upper));
+    }
+    return true;
+  }
+
+  // The first element not less than the key.
+  template <class K>
+  const_iterator lower_bound(const K& key) const {
+    const auto c = FirstChunkNotBelow(key);
+    if (c == chunks_.end()) {
+      return end();
+    }
+    const auto pos = std::lower_bound(c->begin(), c->end(), key, less_);
+    return {&chunks_, static_cast<size_t>(c - chunks_.begin()), static_cast<size_t>(pos - c->begin())};
+  }
+
+  // The first element greater than the key.
+  template <class K>
+  const_iterator upper_bound(const K& key) const {
+    const auto c = std::upper_bound(chunks_.begin(), chunks_.end(), key,
+                                    [this](const K& k, const Chunk& chunk) { return less_(k, chunk.back()); });
+    if (c == chunks_.end()) {
+      return end();
+    }
+    const auto pos = std::upper_bound(c->begin(), c->end(), key, less_);
+    return {&chunks_, static_cast<size_t>(c - chunks_.begin()), static_cast<size_t>(pos - c->begin())};
+  }
+
+ private:
+  template <class K>
+  inline auto FirstChunkNotBelow(const K& key) const {
+    return std::lower_bound(chunks_.begin(), chunks_.end(), key,
+                            [this](const Chunk& chunk, const K& k) { return less_(chunk.back(), k); });
+  }
+
+ private:
+  // every chunk is non-empty and sorted, the last element of a chunk is less than the first one of the next
+  std::vector<Chunk> chunks_;
+  size_t size_ = 0;
+  Compare less_;
+};
+
+}  // namespace storage
@@ -1,36 +1,284 @@
 #include "in_memory_storage.h"
 
 #include "core/datetime.h"
+#include "core/guard.h"
+#include "core/scope.h"
 
-void storage::InMemoryStorage::Store(const proto::Message& message) {
-  auto copy = message;
-  copy.set_message_uid(core::atomics::GetAndIncrement(counter_));
-  for (const auto& to : message.to()) {
-    storage_[to].insert(copy);
+#include "absl/hash/hash.h"
+
+#include <algorithm>
+#include <limits>
+#include <new>
+
+storage::InMemoryStorage::InMemoryStorage()
+    : InMemoryStorage(Options{}) {}
+
+storage::InMemoryStorage::InMemoryStorage(const Options& options) {
+  for (auto& arena : arenas_) {
+    arena.arena = std::make_unique<Arena>(options.huge_pages);
+  }
+}
+
+storage::InMemoryStorage::RecordArena& storage::InMemoryStorage::CurrentArena() noexcept {
+  static core::Atomic next_arena = 0;
+  static thread_local size_t index = static_cast<size_t>(core::atomics::GetAndIncrement(next_arena)) % kArenas;
+  return arenas_[index];
+}
+
+size_t storage::InMemoryStorage::ShardIndex(std::string_view addressee) noexcept {
+  return absl::Hash<std::string_view>{}(addressee) % kShards;
+}
+
+void storage::InMemoryStorage::Record::CopyTo(proto::Message* message) const {
+  message->set_message_uid(uid);
+  message->set_from(from->data(), from->size());
+  for (const auto* name : to) {
+    message->add_to(name->data(), name->size());
+  }
+  message->set_send_ts(send_ts);
+  message->set_message(text.data(), text.size());
+  for (const auto& r : reply) {
+    message->add_reply(r.data(), r.size());
+  }
+}
+
+const storage::InMemoryStorage::Record* storage::InMemoryStorage::MakeRecord(Arena* arena,
+                                                                             const proto::Message& message,
+                                                                             uint64_t uid, NameTable::Id from,
+                                                                             core::ArrayRef<const NameTable::Id> to) {
+  // one block: the record, the addressees, the reply views and the characters
+  size_t chars = message.message().size();
+  for (const auto& r : message.reply()) {
+    chars += r.size();
+  }
+  const size_t replies = static_cast<size_t>(message.reply_size());
+  const size_t size =
+      sizeof(Record) + sizeof(NameTable::Id) * to.size() + sizeof(std::string_view) * replies + chars;
+  auto* block = static_cast<char*>(arena->Allocate(size, alignof(Record)));
+
+  auto* ids = reinterpret_cast<NameTable::Id*>(block + sizeof(Record));
+  std::copy(to.begin(), to.end(), ids);
+  auto* views = reinterpret_cast<std::string_view*>(ids + to.size());
+  auto* text = reinterpret_cast<char*>(views + replies);
+  auto copy = [&text](const std::string& s) {
+    std::string_view view(text, s.size());
+    text = std::copy(s.begin(), s.end(), text);
+    return view;
+  };
+
+  auto* record = new (block) Record{uid, message.send_ts(), from, {ids, to.size()}, copy(message.message()), {}};
+  for (size_t i = 0; i < replies; ++i) {
+    new (views + i) std::string_view(copy(message.reply(static_cast<int>(i))));
+  }
+  record->reply = {views, replies};
+  return record;
+}
+
+storage::IStorage::Uids storage::InMemoryStorage::Store(const proto::Message& message) {
+  const uint64_t uid = core::atomics::GetAndIncrement(counter_);
+  core_defer { MakeVisible(uid, 1); };
+  StoreWithUid(message, uid);
+  return Uids(message.to_size(), uid);
+}
+
+std::vector<bool> storage::InMemoryStorage::StoreBatch(
+    const google::protobuf::RepeatedPtrField<proto::Message>& messages, std::vector<Uids>* uids) {
+  // one counter update reserves the uids of the whole batch
+  const uint64_t first_uid = core::atomics::GetAndAdd(counter_, messages.size());
+  core_defer { MakeVisible(first_uid, static_cast<uint64_t>(messages.size())); };
+
+  std::vector<NameTable::Id> names;
+  for (const auto& message : messages) {
+    names.push_back(names_.Intern(message.from()));
+    for (const auto& to : message.to()) {
+      names.push_back(names_.Intern(to));
+    }
+  }
+
+  std::vector<const Record*> records;
+  records.reserve(messages.size());
+  auto& arena = CurrentArena();
+  core_with_lock(arena.lock) {
+    const NameTable::Id* name = names.data();
+    for (const auto& message : messages) {
+      const core::ArrayRef<const NameTable::Id> to(name + 1, static_cast<size_t>(message.to_size()));
+      records.push_back(MakeRecord(arena.arena.get(), message, first_uid + records.size(), *name, to));
+      name = to.end();
+    }
+  }
+
+  // every shard is locked once for all its timelines of the batch
+  struct Insert {
+    size_t shard;
+    NameTable::Id user;
+    const Record* record;
+    bool sent;
+  };
+  std::vector<Insert> inserts;
+  inserts.reserve(names.size());
+  for (const auto* record : records) {
+    inserts.push_back({ShardIndex(*record->from), record->from, record, true});
+    for (const auto* to : record->to) {
+      inserts.push_back({ShardIndex(*to), to, record, false});
+    }
+  }
+  std::stable_sort(inserts.begin(), inserts.end(), [](const Insert& l, const Insert& r) { return l.shard < r.shard; });
+  for (auto it = inserts.begin(); it != inserts.end();) {
+    auto& shard = shards_[it->shard];
+    core_with_lock(shard.lock) {
+      for (const auto index = it->shard; it != inserts.end() && it->shard == index; ++it) {
+        const Entry entry{it->record->send_ts, it->record->uid, it->record};
+        if (it->sent) {
+          shard.sent[it->user].insert(entry);
+        } else {
+          shard.timelines[it->user].insert(entry);
+        }
+      }
+    }
+  }
+  if (uids != nullptr) {
+    uids->clear();
+    uids->reserve(records.size());
+    for (const auto* record : records) {
+      uids->emplace_back(record->to.size(), record->uid);
+    }
+  }
+  return std::vector<bool>(messages.size(), true);
+}
+
+void storage::InMemoryStorage::StoreWithUid(const proto::Message& message, uint64_t uid) {
+  const auto from = names_.Intern(message.from());
+  std::vector<NameTable::Id> to;
+  to.reserve(message.to_size());
+  for (const auto& name : message.to()) {
+    to.push_back(names_.Intern(name));
+  }
+
+  const Record* record = nullptr;
+  auto& arena = CurrentArena();
+  core_with_lock(arena.lock) { record = MakeRecord(arena.arena.get(), message, uid, from, to); }
+
+  auto& sender = ShardOf(*from);
+  core_with_lock(sender.lock) { sender.sent[from].insert({record->send_ts, uid, record}); }
+  for (const auto* name : record->to) {
+    auto& shard = ShardOf(*name);
+    core_with_lock(shard.lock) { shard.timelines[name].insert({record->send_ts, uid, record}); }
+  }
+}
+
+void storage::InMemoryStorage::MakeVisible(uint64_t first_uid, uint64_t count) noexcept {
+  if (count == 0) {
+    return;
+  }
+  // the stores in front insert a few timeline entries, a failed one still passes its uids on
+  core::SpinWait sw;
+  while (static_cast<uint64_t>(core::atomics::Load(visible_)) != first_uid) {
+    sw.sleep();
   }
+  core::atomics::Store(visible_, static_cast<core::AtomicType>(first_uid + count));
+}
+
+storage::InMemoryStorage::Entry storage::InMemoryStorage::LastVisible() noexcept {
+  return {static_cast<uint64_t>(absl::ToUnixSeconds(absl::Now())), std::numeric_limits<uint64_t>::max(), nullptr};
 }
 
 std::vector<proto::Message> storage::InMemoryStorage::Load(const std::vector<std::string>& possible_addressees) {
   std::vector<proto::Message> result;
-  proto::Message pivot;
-  pivot.set_send_ts(absl::ToUnixSeconds(absl::Now()));
+  const auto last = LastVisible();
   for (const auto& t : possible_addressees) {
-    const auto it = storage_.find(t);
-    if (it != storage_.end()) {
-      result.insert(result.end(), it->second.begin(), it->second.upper_bound(pivot));
+    const auto id = names_.Find(t);
+    if (id == nullptr) {
+      continue;
+    }
+    const auto& shard = ShardOf(t);
+    core_with_lock(shard.lock) {
+      const auto it = shard.timelines.find(id);
+      if (it != shard.timelines.end()) {
+        const auto end = it->second.upper_bound(last);
+        for (auto m = it->second.begin(); m != end; ++m) {
+          m->record->CopyTo(&result.emplace_back());
+        }
+      }
     }
   }
   return result;
 }
 
-std::vector<proto::Message> storage::InMemoryStorage::LoadSended(const std::string& user) {
-  std::vector<proto::Message> result;
-  for (const auto& to : storage_) {
-    for (const auto& message : to.second) {
-      if (message.from() == user) {
-        result.push_back(message);
+template <class F>
+void storage::InMemoryStorage::ForEachAfterCursor(const std::vector<std::string>& possible_addressees,
+                                                  const Cursor& cursor, F&& f) const {
+  const Entry after{cursor.after_ts, cursor.after_uid, nullptr};
+  const auto last = LastVisible();
+  const auto visible = static_cast<uint64_t>(core::atomics::Load(visible_));
+  for (const auto& t : possible_addressees) {
+    // a name that was never interned has no messages
+    const auto id = names_.Find(t);
+    if (id == nullptr) {
+      continue;
+    }
+    const auto& shard = ShardOf(t);
+    core_with_lock(shard.lock) {
+      const auto it = shard.timelines.find(id);
+      if (it == shard.timelines.end()) {
+        continue;
+      }
+      size_t taken = 0;
+      const auto end = it->second.upper_bound(last);
+      for (auto m = it->second.upper_bound(after); m != end && (cursor.limit == 0 || taken < cursor.limit); ++m) {
+        // nothing after a message that is still stored, the next page would start past it
+        if (m->uid >= visible) {
+          break;
+        }
+        f(*m->record);
+        ++taken;
       }
     }
   }
+}
+
+template <class F>
+void storage::InMemoryStorage::ForEachSended(const std::string& user, F&& f) const {
+  const auto id = names_.Find(user);
+  if (id == nullptr) {
+    return;
+  }
+  // like the loads of the addressees, messages sent in the future are not visible yet
+  const auto last = LastVisible();
+  const auto& shard = ShardOf(user);
+  core_with_lock(shard.lock) {
+    const auto it = shard.sent.find(id);
+    if (it == shard.sent.end()) {
+      return;
+    }
+    const auto end = it->second.upper_bound(last);
+    for (auto m = it->second.begin(); m != end; ++m) {
+      f(*m->record);
+    }
+  }
+}
+
+std::vector<proto::Message> storage::InMemoryStorage::Load(const std::vector<std::string>& possible_addressees,
+                                                          const Cursor& cursor) {
+  std::vector<proto::Message> result;
+  ForEachAfterCursor(possible_addressees, cursor, [&result](const Record& r) { r.CopyTo(&result.emplace_back()); });
+  SortAndTruncate(result, cursor.limit);
   return result;
 }
+
+std::vector<proto::Message> storage::InMemoryStorage::LoadSended(const std::string& user) {
+  std::vector<proto::Message> result;
+  ForEachSended(user, [&result](const Record& r) { r.CopyTo(&result.emplace_back()); });
+  return result;
+}
+
+void storage::InMemoryStorage::LoadInto(const std::vector<std::string>& possible_addressees, const Cursor& cursor,
+                                        google::protobuf::RepeatedPtrField<proto::Message>* sink) {
+  const int from = sink->size();
+  ForEachAfterCursor(possible_addressees, cursor, [sink](const Record& r) { r.CopyTo(sink->Add()); });
+  SortAndTruncate(sink, from, cursor.limit);
+}
+
+void storage::InMemoryStorage::LoadSendedInto(const std::string& user,
+                                              google::protobuf::RepeatedPtrField<proto::Message>* sink) {
+  ForEachSended(user, [sink](const Record& r) { r.CopyTo(sink->Add()); });
+}
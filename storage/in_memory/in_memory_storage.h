@@ -1,31 +1,134 @@
 #pragma once
 
+#include "core/array_ref.h"
 #include "core/atomic.h"
+#include "core/mutex.h"
+#include "core/spinlock.h"
+#include "storage/in_memory/arena.h"
+#include "storage/in_memory/chunked_set.h"
+#include "storage/in_memory/name_table.h"
 #include "storage/storage.h"
 
-#include "absl/container/btree_set.h"
 #include "absl/container/flat_hash_map.h"
 
+#include <array>
+#include <memory>
+#include <string_view>
+
 namespace storage {
 
 class InMemoryStorage final : public IStorage {
  public:
-  void Store(const proto::Message& message) override;
+  struct Options {
+    // Records are kept in 2MiB slabs advised as transparent huge pages, every record arena reserves one at least.
+    bool huge_pages = false;
+  };
+
+  InMemoryStorage();
+  explicit InMemoryStorage(const Options& options);
+
+  Uids Store(const proto::Message& message) override;
+
+  std::vector<bool> StoreBatch(const google::protobuf::RepeatedPtrField<proto::Message>& messages,
+                               std::vector<Uids>* uids = nullptr) override;
 
   std::vector<proto::Message> Load(const std::vector<std::string>& possible_addressees) override;
 
+  std::vector<proto::Message> Load(const std::vector<std::string>& possible_addressees, const Cursor& cursor) override;
+
   std::vector<proto::Message> LoadSended(const std::string& user) override;
 
+  void LoadInto(const std::vector<std::string>& possible_addressees, const Cursor& cursor,
+                google::protobuf::RepeatedPtrField<proto::Message>* sink) override;
+
+  void LoadSendedInto(const std::string& user, google::protobuf::RepeatedPtrField<proto::Message>* sink) override;
+
+  // Safe for concurrent callers, see Shard.
+  [[nodiscard]] LockType ProtectStorageBy() const noexcept override { return LockType::kNone; }
+
+ private:
+  template <class F>
+  void ForEachAfterCursor(const std::vector<std::string>& possible_addressees, const Cursor& cursor, F&& f) const;
+
+  template <class F>
+  void ForEachSended(const std::string& user, F&& f) const;
+
+  void StoreWithUid(const proto::Message& message, uint64_t uid);
+
+  // Called once the messages with `count` uids from `first_uid` are in all their timelines, waits for the stores of
+  // the smaller uids so the messages become visible in the uid order.
+  void MakeVisible(uint64_t first_uid, uint64_t count) noexcept;
+
  private:
-  struct MessageComparator {
-    inline bool operator()(const proto::Message& l, const proto::Message& r) const noexcept {
-      return std::less<>{}(l.send_ts(), r.send_ts());
+  // A stored message, shared by the timelines of all its addressees and of its sender. It is one arena block together
+  // with its strings and is never freed before the storage.
+  struct Record {
+    uint64_t uid;
+    uint64_t send_ts;
+    NameTable::Id from;
+    core::ArrayRef<const NameTable::Id> to;
+    std::string_view text;
+    core::ArrayRef<const std::string_view> reply;
+
+    void CopyTo(proto::Message* message) const;
+  };
+
+  struct Entry {
+    uint64_t send_ts;
+    uint64_t uid;
+    const Record* record;
+  };
+
+  // the cursor order, a uid tells apart messages of the same second
+  struct EntryComparator {
+    inline bool operator()(const Entry& l, const Entry& r) const noexcept {
+      return l.send_ts != r.send_ts ? l.send_ts < r.send_ts : l.uid < r.uid;
     }
   };
 
+  using Timeline = ChunkedSet<Entry, EntryComparator>;
+
+  // the names of the message are interned already
+  static const Record* MakeRecord(Arena* arena, const proto::Message& message, uint64_t uid, NameTable::Id from,
+                                  core::ArrayRef<const NameTable::Id> to);
+
+  // the key after the last message of the current second, later messages are not loaded yet
+  static Entry LastVisible() noexcept;
+
+  // Timelines are spread over the shards by the hash of the addressee, sent timelines by the hash of the sender.
+  // Calls for different users rarely wait for the same lock.
+  struct alignas(64) Shard {
+    mutable core::Mutex lock;
+    absl::flat_hash_map<NameTable::Id, Timeline> timelines;
+    absl::flat_hash_map<NameTable::Id, Timeline> sent;
+  };
+
+  // Records are allocated in the order of the calls of a thread, like malloc does, so a batch or a prefilled mailbox
+  // stays in a few pages.
+  struct alignas(64) RecordArena {
+    core::AdaptiveLock lock;
+    std::unique_ptr<Arena> arena;
+  };
+
+  static constexpr size_t kArenas = 8;
+
+  RecordArena& CurrentArena() noexcept;
+
+  static constexpr size_t kShards = 64;
+
+  static size_t ShardIndex(std::string_view addressee) noexcept;
+
+  inline Shard& ShardOf(std::string_view addressee) noexcept { return shards_[ShardIndex(addressee)]; }
+  inline const Shard& ShardOf(std::string_view addressee) const noexcept { return shards_[ShardIndex(addressee)]; }
+
  private:
   core::Atomic counter_ = 0;
-  absl::flat_hash_map<std::string, absl::btree_set<proto::Message, MessageComparator>> storage_;
+  // Messages with smaller uids are in all their timelines. Cursor loads stop at a larger uid, a page that ended with
+  // uid 6 would move the cursor of the client past a uid 5 that is still being inserted.
+  core::Atomic visible_ = 0;
+  NameTable names_;
+  std::array<RecordArena, kArenas> arenas_;
+  std::array<Shard, kShards> shards_;
 };
 
 }  // namespace storage
\ No newline at end of file
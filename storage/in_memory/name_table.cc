@@ -0,0 +1,41 @@
+#include "name_table.h"
+
+#include "core/guard.h"
+
+#include "absl/hash/hash.h"
+
+#include <new>
+
+size_t storage::NameTable::ShardIndex(std::string_view name) noexcept {
+  // the upper bits, the storage shards use the lower ones of the same hash
+  return (absl::Hash<std::string_view>{}(name) >> 32) % kShards;
+}
+
+storage::NameTable::Id storage::NameTable::Intern(std::string_view name) {
+  auto& shard = shards_[ShardIndex(name)];
+  core_with_lock(shard.lock) {
+    const auto it = shard.ids.find(name);
+    if (it != shard.ids.end()) {
+      return it->second;
+    }
+    auto* id = new (shard.arena.AllocateArray<std::string_view>(1)) std::string_view(shard.arena.Copy(name));
+    shard.ids.emplace(*id, id);
+    return id;
+  }
+}
+
+storage::NameTable::Id storage::NameTable::Find(std::string_view name) const {
+  const auto& shard = shards_[ShardIndex(name)];
+  core_with_lock(shard.lock) {
+    const auto it = shard.ids.find(name);
+    return it != shard.ids.end() ? it->second : nullptr;
+  }
+}
+
+size_t storage::NameTable::Size() const {
+  size_t size = 0;
+  for (const auto& shard : shards_) {
+    core_with_lock(shard.lock) { size += shard.ids.size(); }
+  }
+  return size;
+}
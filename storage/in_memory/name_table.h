@@ -0,0 +1,43 @@
+#pragma once
+
+#include "core/mutex.h"
+#include "core/noncopyable.h"
+#include "storage/in_memory/arena.h"
+
+#include "absl/container/flat_hash_map.h"
+
+#include <array>
+#include <string_view>
+
+namespace storage {
+
+// User and group names interned for the lifetime of the table. A name is stored once however many messages mention
+// it, its id is the address of the stored name, so ids of equal names are equal and the name is read without a lock.
+class NameTable : public core::NonCopyable {
+ public:
+  using Id = const std::string_view*;
+
+  Id Intern(std::string_view name);
+
+  // nullptr if the name was never interned
+  Id Find(std::string_view name) const;
+
+  size_t Size() const;
+
+ private:
+  struct alignas(64) Shard {
+    mutable core::Mutex lock;
+    // keys point to the names in the arena
+    absl::flat_hash_map<std::string_view, Id> ids;
+    Arena arena;
+  };
+
+  static constexpr size_t kShards = 16;
+
+  static size_t ShardIndex(std::string_view name) noexcept;
+
+ private:
+  std::array<Shard, kShards> shards_;
+};
+
+}  // namespace storage
@@ -0,0 +1,59 @@
+#include "storage/in_memory/arena.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+TEST(Arena, TestAllocate) {
+  storage::Arena arena;
+  ASSERT_EQ(arena.Reserved(), 0);
+
+  auto* c = static_cast<char*>(arena.Allocate(1, 1));
+  auto* p = arena.AllocateArray<uint64_t>(4);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(p) % alignof(uint64_t), 0);
+  ASSERT_GT(reinterpret_cast<char*>(p), c);
+  ASSERT_EQ(arena.Reserved(), storage::Arena::kSlabSize);
+
+  // blocks do not overlap once the first slab is full
+  std::vector<uint64_t*> blocks;
+  for (uint64_t i = 0; i < 2 * storage::Arena::kSlabSize / 64; ++i) {
+    blocks.push_back(arena.AllocateArray<uint64_t>(8));
+    std::fill(blocks.back(), blocks.back() + 8, i);
+  }
+  for (uint64_t i = 0; i < blocks.size(); ++i) {
+    ASSERT_EQ(blocks[i][0], i);
+    ASSERT_EQ(blocks[i][7], i);
+  }
+  ASSERT_GE(arena.Reserved(), 2 * storage::Arena::kSlabSize);
+}
+
+TEST(Arena, TestLargeBlock) {
+  storage::Arena arena;
+  auto* small = static_cast<char*>(arena.Allocate(16));
+  auto* large = static_cast<char*>(arena.Allocate(storage::Arena::kSlabSize));
+  memset(large, 1, storage::Arena::kSlabSize);
+  // the current slab keeps serving small blocks
+  auto* next = static_cast<char*>(arena.Allocate(16));
+  ASSERT_EQ(next, small + 16);
+  ASSERT_EQ(arena.Reserved(), 2 * storage::Arena::kSlabSize);
+}
+
+TEST(Arena, TestCopy) {
+  storage::Arena arena;
+  std::string s = "hello";
+  const auto copy = arena.Copy(s);
+  s = "world";
+  ASSERT_EQ(copy, "hello");
+  ASSERT_TRUE(arena.Copy("").empty());
+}
+
+TEST(Arena, TestHugePages) {
+  storage::Arena arena(true);
+  auto* p = static_cast<char*>(arena.Allocate(100));
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(p) % storage::Arena::kHugeSlabSize, 0);
+  ASSERT_EQ(arena.Reserved(), storage::Arena::kHugeSlabSize);
+}
@@ -0,0 +1,51 @@
+#include "storage/in_memory/chunked_set.h"
+
+#include "gtest/gtest.h"
+
+#include <functional>
+#include <random>
+#include <set>
+#include <vector>
+
+using SmallChunkedSet = storage::ChunkedSet<int, std::less<int>, 4>;
+
+static std::vector<int> Elements(const SmallChunkedSet& set) { return {set.begin(), set.end()}; }
+
+TEST(ChunkedSet, TestAppend) {
+  SmallChunkedSet set;
+  ASSERT_TRUE(set.empty());
+  ASSERT_TRUE(set.begin() == set.end());
+
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_TRUE(set.insert(i));
+  }
+  ASSERT_FALSE(set.insert(9));
+  ASSERT_FALSE(set.insert(3));
+  ASSERT_EQ(set.size(), 10);
+  ASSERT_EQ(Elements(set), std::vector<int>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+}
+
+TEST(ChunkedSet, TestRandomInserts) {
+  std::mt19937 rng(42);
+  SmallChunkedSet set;
+  std::set<int> expected;
+  for (size_t i = 0; i < 1000; ++i) {
+    const int value = static_cast<int>(rng() % 500);
+    ASSERT_EQ(set.insert(value), expected.insert(value).second);
+  }
+  ASSERT_EQ(set.size(), expected.size());
+  ASSERT_EQ(Elements(set), std::vector<int>(expected.begin(), expected.end()));
+
+  for (int key = -1; key <= 501; ++key) {
+    const auto lower = set.lower_bound(key);
+    const auto upper = set.upper_bound(key);
+    ASSERT_EQ(lower == set.end(), expected.lower_bound(key) == expected.end()) << key;
+    ASSERT_EQ(upper == set.end(), expected.upper_bound(key) == expected.end()) << key;
+    if (lower != set.end()) {
+      ASSERT_EQ(*lower, *expected.lower_bound(key)) << key;
+    }
+    if (upper != set.end()) {
+      ASSERT_EQ(*upper, *expected.upper_bound(key)) << key;
+    }
+  }
+}
@@ -0,0 +1,52 @@
+#include "storage/in_memory/name_table.h"
+
+#include "gtest/gtest.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(NameTable, TestIntern) {
+  storage::NameTable names;
+  ASSERT_EQ(names.Find("user1"), nullptr);
+
+  std::string name = "user1";
+  const auto id = names.Intern(name);
+  ASSERT_EQ(*id, "user1");
+  name = "user2";
+  ASSERT_EQ(*id, "user1");
+
+  ASSERT_EQ(names.Intern("user1"), id);
+  ASSERT_EQ(names.Find("user1"), id);
+  ASSERT_NE(names.Intern("user2"), id);
+  ASSERT_EQ(names.Size(), 2);
+
+  ASSERT_EQ(*names.Intern(""), "");
+}
+
+TEST(NameTable, TestConcurrentIntern) {
+  static constexpr size_t kThreads = 4;
+  static constexpr size_t kNames = 1000;
+
+  storage::NameTable names;
+  std::vector<std::vector<storage::NameTable::Id>> ids(kThreads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&names, &ids, t] {
+      for (size_t i = 0; i < kNames; ++i) {
+        ids[t].push_back(names.Intern("user" + std::to_string(i)));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  ASSERT_EQ(names.Size(), kNames);
+  for (size_t i = 0; i < kNames; ++i) {
+    ASSERT_EQ(*ids[0][i], "user" + std::to_string(i));
+    for (size_t t = 1; t < kThreads; ++t) {
+      ASSERT_EQ(ids[t][i], ids[0][i]);
+    }
+  }
+}
@@ -2,6 +2,11 @@
 
 #include "gtest/gtest.h"
 
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
 using proto::Message;
 using storage::InMemoryStorage;
 
@@ -89,10 +94,303 @@ TEST(InMemoryStorage, TestStoreLoadSended) {
   auto res3 = storage.LoadSended("from3");
 
   ASSERT_EQ(res1.size(), 1);
-  ASSERT_EQ(res2.size(), 2);
+  ASSERT_EQ(res2.size(), 1);
   ASSERT_EQ(res3.size(), 0);
 
   ASSERT_EQ(res1[0].from(), "from1");
   ASSERT_EQ(res2[0].from(), "from2");
-  ASSERT_EQ(res2[1].from(), "from2");
-}
\ No newline at end of file
+  ASSERT_EQ(res2[0].to_size(), 2);
+}
+
+TEST(InMemoryStorage, TestLoadSendedOnce) {
+  InMemoryStorage storage;
+
+  for (size_t i = 0; i < 3; ++i) {
+    Message m;
+    m.set_from("from1");
+    m.add_to("to" + std::to_string(i));
+    m.add_to("@group");
+    m.set_send_ts(10);
+    ASSERT_NO_THROW(storage.Store(m));
+  }
+  Message future;
+  future.set_from("from1");
+  future.add_to("to1");
+  future.set_send_ts(absl::ToUnixSeconds(absl::Now()) + 2000);
+  ASSERT_NO_THROW(storage.Store(future));
+
+  auto res = storage.LoadSended("from1");
+  ASSERT_EQ(res.size(), 3);
+  for (size_t i = 0; i < res.size(); ++i) {
+    ASSERT_EQ(res[i].message_uid(), i);
+    ASSERT_EQ(res[i].to(0), "to" + std::to_string(i));
+  }
+}
+
+TEST(InMemoryStorage, TestLoadCursor) {
+  InMemoryStorage storage;
+
+  for (uint64_t ts = 10; ts < 15; ++ts) {
+    Message m;
+    m.set_from("from1");
+    m.add_to(ts % 2 == 0 ? "to1" : "@group");
+    m.set_send_ts(ts);
+    m.set_message("hello");
+    ASSERT_NO_THROW(storage.Store(m));
+  }
+
+  InMemoryStorage::Cursor cursor;
+  cursor.limit = 2;
+
+  auto res1 = storage.Load({"to1", "@group"}, cursor);
+  ASSERT_EQ(res1.size(), 2);
+  ASSERT_EQ(res1[0].send_ts(), 10);
+  ASSERT_EQ(res1[1].send_ts(), 11);
+
+  cursor.after_ts = res1.back().send_ts();
+  cursor.after_uid = res1.back().message_uid();
+  auto res2 = storage.Load({"to1", "@group"}, cursor);
+  ASSERT_EQ(res2.size(), 2);
+  ASSERT_EQ(res2[0].send_ts(), 12);
+  ASSERT_EQ(res2[1].send_ts(), 13);
+
+  cursor.after_ts = res2.back().send_ts();
+  cursor.after_uid = res2.back().message_uid();
+  cursor.limit = 0;
+  auto res3 = storage.Load({"to1", "@group"}, cursor);
+  ASSERT_EQ(res3.size(), 1);
+  ASSERT_EQ(res3[0].send_ts(), 14);
+
+  cursor.after_ts = res3.back().send_ts();
+  cursor.after_uid = res3.back().message_uid();
+  ASSERT_EQ(storage.Load({"to1", "@group"}, cursor).size(), 0);
+}
+
+TEST(InMemoryStorage, TestStoreBatch) {
+  InMemoryStorage storage;
+
+  ASSERT_TRUE(storage.Store(Message()).empty());
+
+  google::protobuf::RepeatedPtrField<Message> batch;
+  for (uint64_t ts = 10; ts < 13; ++ts) {
+    auto* m = batch.Add();
+    m->set_from("from1");
+    m->add_to("to1");
+    m->set_send_ts(ts);
+    m->set_message("hello");
+  }
+
+  std::vector<InMemoryStorage::Uids> uids;
+  auto stored = storage.StoreBatch(batch, &uids);
+  ASSERT_EQ(stored.size(), 3);
+  ASSERT_TRUE(stored[0] && stored[1] && stored[2]);
+  ASSERT_EQ(uids, std::vector<InMemoryStorage::Uids>({{1}, {2}, {3}}));
+
+  auto res = storage.Load({"to1"}, InMemoryStorage::Cursor());
+  ASSERT_EQ(res.size(), 3);
+  for (size_t i = 0; i < res.size(); ++i) {
+    ASSERT_EQ(res[i].send_ts(), 10 + i);
+    ASSERT_EQ(res[i].message_uid(), 1 + i);
+  }
+
+  ASSERT_EQ(storage.StoreBatch({}).size(), 0);
+}
+
+TEST(InMemoryStorage, TestLoadInto) {
+  InMemoryStorage storage;
+
+  for (uint64_t ts = 14; ts >= 10; --ts) {
+    Message m;
+    m.set_from(ts % 2 == 0 ? "from1" : "from2");
+    m.add_to(ts % 2 == 0 ? "to1" : "@group");
+    m.set_send_ts(ts);
+    m.set_message("hello");
+    ASSERT_NO_THROW(storage.Store(m));
+  }
+
+  google::protobuf::RepeatedPtrField<Message> messages;
+  messages.Add()->set_message("kept");
+
+  InMemoryStorage::Cursor cursor;
+  cursor.after_ts = 10;
+  cursor.after_uid = 4;
+  cursor.limit = 3;
+  storage.LoadInto({"to1", "@group"}, cursor, &messages);
+  ASSERT_EQ(messages.size(), 4);
+  ASSERT_EQ(messages.Get(0).message(), "kept");
+  ASSERT_EQ(messages.Get(1).send_ts(), 11);
+  ASSERT_EQ(messages.Get(2).send_ts(), 12);
+  ASSERT_EQ(messages.Get(3).send_ts(), 13);
+
+  messages.Clear();
+  storage.LoadSendedInto("from2", &messages);
+  ASSERT_EQ(messages.size(), 2);
+}
+
+TEST(InMemoryStorage, TestConcurrentUsers) {
+  static constexpr size_t kThreads = 8;
+  static constexpr size_t kMessages = 500;
+
+  InMemoryStorage storage;
+  ASSERT_EQ(storage.ProtectStorageBy(), InMemoryStorage::LockType::kNone);
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&storage, t] {
+      const auto user = "user" + std::to_string(t);
+      for (size_t i = 0; i < kMessages; ++i) {
+        Message m;
+        m.set_from(user);
+        m.add_to(user);
+        m.add_to("@all");
+        m.set_send_ts(t * kMessages + i + 1);
+        if (i % 2 == 0) {
+          storage.Store(m);
+        } else {
+          google::protobuf::RepeatedPtrField<Message> batch;
+          *batch.Add() = m;
+          storage.StoreBatch(batch);
+        }
+        InMemoryStorage::Cursor cursor;
+        cursor.limit = 1;
+        storage.Load({user, "@all"}, cursor);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (size_t t = 0; t < kThreads; ++t) {
+    const auto user = "user" + std::to_string(t);
+    ASSERT_EQ(storage.Load({user}, InMemoryStorage::Cursor()).size(), kMessages);
+    ASSERT_EQ(storage.LoadSended(user).size(), kMessages);
+  }
+}
+
+TEST(InMemoryStorage, TestConcurrentCursor) {
+  static constexpr size_t kThreads = 4;
+  static constexpr size_t kMessages = 2000;
+
+  InMemoryStorage storage;
+  std::atomic<size_t> writers = kThreads;
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&storage, &writers, t] {
+      for (size_t i = 0; i < kMessages; ++i) {
+        // one second for all, stores of different fan-out finish out of uid order
+        Message m;
+        m.set_from("from" + std::to_string(t));
+        m.add_to("to");
+        for (size_t j = 0; j < (i + t) % 32; ++j) {
+          m.add_to("other" + std::to_string(j));
+        }
+        m.set_send_ts(10);
+        storage.Store(m);
+      }
+      --writers;
+    });
+  }
+
+  // a reader that pages after the last message it got must see every uid once
+  std::vector<uint64_t> uids;
+  InMemoryStorage::Cursor cursor;
+  cursor.limit = 7;
+  while (true) {
+    const bool done = writers == 0;
+    const auto res = storage.Load({"to"}, cursor);
+    for (const auto& m : res) {
+      uids.push_back(m.message_uid());
+    }
+    if (!res.empty()) {
+      cursor.after_ts = res.back().send_ts();
+      cursor.after_uid = res.back().message_uid();
+    } else if (done) {
+      break;
+    }
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  ASSERT_EQ(uids.size(), kThreads * kMessages);
+  for (size_t i = 0; i < uids.size(); ++i) {
+    ASSERT_EQ(uids[i], i);
+  }
+}
+
+TEST(InMemoryStorage, TestFanOut) {
+  InMemoryStorage storage;
+
+  Message m;
+  m.set_from("from1");
+  std::vector<std::string> recipients;
+  for (size_t i = 0; i < 200; ++i) {
+    recipients.push_back("to" + std::to_string(i));
+    m.add_to(recipients.back());
+  }
+  m.set_send_ts(10);
+  m.set_message("hello");
+  ASSERT_EQ(storage.Store(m), InMemoryStorage::Uids(200, 0));
+
+  for (const auto& to : recipients) {
+    auto res = storage.Load({to}, InMemoryStorage::Cursor());
+    ASSERT_EQ(res.size(), 1);
+    ASSERT_EQ(res[0].message(), "hello");
+    ASSERT_EQ(res[0].to_size(), 200);
+    ASSERT_EQ(res[0].message_uid(), 0);
+  }
+  ASSERT_EQ(storage.Load(recipients, InMemoryStorage::Cursor()).size(), 200);
+}
+
+TEST(InMemoryStorage, TestSameSecond) {
+  InMemoryStorage storage;
+
+  for (size_t i = 0; i < 3; ++i) {
+    Message m;
+    m.set_from("from1");
+    m.add_to("to1");
+    m.set_send_ts(10);
+    m.set_message("hello" + std::to_string(i));
+    ASSERT_NO_THROW(storage.Store(m));
+  }
+
+  ASSERT_EQ(storage.Load({"to1"}).size(), 3);
+
+  InMemoryStorage::Cursor cursor;
+  cursor.after_ts = 10;
+  cursor.after_uid = 0;
+  auto res = storage.Load({"to1"}, cursor);
+  ASSERT_EQ(res.size(), 2);
+  ASSERT_EQ(res[0].message(), "hello1");
+  ASSERT_EQ(res[1].message(), "hello2");
+}
+
+TEST(InMemoryStorage, TestRecordFields) {
+  InMemoryStorage storage(InMemoryStorage::Options{true});
+
+  Message m;
+  m.set_from("from1");
+  m.add_to("to1");
+  m.add_to("to2");
+  m.set_send_ts(10);
+  m.set_message("hello");
+  m.add_reply("reply1");
+  m.add_reply("");
+  m.add_reply("reply3");
+  ASSERT_NO_THROW(storage.Store(m));
+  google::protobuf::RepeatedPtrField<Message> batch;
+  *batch.Add() = m;
+  ASSERT_EQ(storage.StoreBatch(batch), std::vector<bool>({true}));
+
+  for (const auto& res : {storage.Load({"to2"}), storage.LoadSended("from1")}) {
+    ASSERT_EQ(res.size(), 2);
+    for (size_t i = 0; i < res.size(); ++i) {
+      auto expected = m;
+      expected.set_message_uid(i);
+      ASSERT_EQ(res[i].SerializeAsString(), expected.SerializeAsString());
+    }
+  }
+  ASSERT_TRUE(storage.Load({"unknown"}).empty());
+  ASSERT_TRUE(storage.LoadSended("unknown").empty());
+}
@@ -1 +1,83 @@
 #include "storage.h"
+
+#include "core/exception.h"
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+
+bool storage::IsAfterCursor(const proto::Message& message, const IStorage::Cursor& cursor) noexcept {
+  return std::make_tuple(message.send_ts(), message.message_uid()) > std::make_tuple(cursor.after_ts, cursor.after_uid);
+}
+
+static bool ByCursorOrder(const proto::Message& l, const proto::Message& r) noexcept {
+  return std::make_tuple(l.send_ts(), l.message_uid()) < std::make_tuple(r.send_ts(), r.message_uid());
+}
+
+void storage::SortAndTruncate(std::vector<proto::Message>& messages, size_t limit) {
+  std::sort(messages.begin(), messages.end(), ByCursorOrder);
+  if (limit != 0 && messages.size() > limit) {
+    messages.resize(limit);
+  }
+}
+
+void storage::SortAndTruncate(google::protobuf::RepeatedPtrField<proto::Message>* sink, int from, size_t limit) {
+  // sorting the element pointers moves no message
+  std::sort(sink->pointer_begin() + from, sink->pointer_end(),
+            [](const proto::Message* l, const proto::Message* r) { return ByCursorOrder(*l, *r); });
+  const auto taken = static_cast<size_t>(sink->size() - from);
+  if (limit != 0 && taken > limit) {
+    sink->DeleteSubrange(from + static_cast<int>(limit), static_cast<int>(taken - limit));
+  }
+}
+
+std::vector<bool> storage::IStorage::StoreBatch(const google::protobuf::RepeatedPtrField<proto::Message>& messages,
+                                                std::vector<Uids>* uids) {
+  std::vector<bool> result;
+  result.reserve(messages.size());
+  if (uids != nullptr) {
+    uids->clear();
+    uids->reserve(messages.size());
+  }
+  for (const auto& message : messages) {
+    Uids stored;
+    try {
+      stored = Store(message);
+      result.push_back(true);
+    } catch (const core::Exception&) {
+      result.push_back(false);
+    }
+    if (uids != nullptr) {
+      uids->push_back(std::move(stored));
+    }
+  }
+  return result;
+}
+
+std::vector<proto::Message> storage::IStorage::Load(const std::vector<std::string>& possible_addressees,
+                                                    const Cursor& cursor) {
+  auto result = Load(possible_addressees);
+  result.erase(std::remove_if(result.begin(), result.end(),
+                              [&cursor](const proto::Message& m) { return !IsAfterCursor(m, cursor); }),
+               result.end());
+  SortAndTruncate(result, cursor.limit);
+  return result;
+}
+
+void storage::IStorage::LoadInto(const std::vector<std::string>& possible_addressees, const Cursor& cursor,
+                                 google::protobuf::RepeatedPtrField<proto::Message>* sink) {
+  auto result = Load(possible_addressees, cursor);
+  sink->Reserve(sink->size() + static_cast<int>(result.size()));
+  for (auto& message : result) {
+    *sink->Add() = std::move(message);
+  }
+}
+
+void storage::IStorage::LoadSendedInto(const std::string& user,
+                                       google::protobuf::RepeatedPtrField<proto::Message>* sink) {
+  auto result = LoadSended(user);
+  sink->Reserve(sink->size() + static_cast<int>(result.size()));
+  for (auto& message : result) {
+    *sink->Add() = std::move(message);
+  }
+}
@@ -2,6 +2,8 @@
 
 #include "proto/message.pb.h"
 
+#include "google/protobuf/repeated_field.h"
+
 #include <string_view>
 #include <vector>
 
@@ -10,15 +12,48 @@ namespace storage {
 struct IStorage {
   enum class LockType { kNone, kSpinLock, kMutex };
 
+  struct Cursor {
+    uint64_t after_ts = 0;
+    uint64_t after_uid = 0;
+    size_t limit = 0;
+  };
+
+  // Uids assigned to a stored message, one for every addressee in the order of message.to(). A storage that keeps one
+  // record for all the addressees repeats its uid.
+  using Uids = std::vector<uint64_t>;
+
   virtual ~IStorage() noexcept = default;
 
-  virtual void Store(const proto::Message& message) = 0;
+  virtual Uids Store(const proto::Message& message) = 0;
+
+  // Stores the messages with one transaction or lock acquisition, the result tells whether each message was stored.
+  // Throws if the batch as a whole failed. `uids`, if given, receives the uids of every message, none for the ones
+  // that were not stored.
+  virtual std::vector<bool> StoreBatch(const google::protobuf::RepeatedPtrField<proto::Message>& messages,
+                                       std::vector<Uids>* uids = nullptr);
 
   virtual std::vector<proto::Message> Load(const std::vector<std::string>& possible_addressees) = 0;
 
+  // Messages ordered by (send_ts, message_uid) strictly after the cursor, at most cursor.limit of them.
+  virtual std::vector<proto::Message> Load(const std::vector<std::string>& possible_addressees, const Cursor& cursor);
+
   virtual std::vector<proto::Message> LoadSended(const std::string& user) = 0;
 
+  // Sink variants of Load and LoadSended, they append the messages to `sink` so the caller can hand in the field of
+  // an arena allocated response. The defaults fall back to the vector API.
+  virtual void LoadInto(const std::vector<std::string>& possible_addressees, const Cursor& cursor,
+                        google::protobuf::RepeatedPtrField<proto::Message>* sink);
+
+  virtual void LoadSendedInto(const std::string& user, google::protobuf::RepeatedPtrField<proto::Message>* sink);
+
   [[nodiscard]] virtual LockType ProtectStorageBy() const noexcept { return LockType::kNone; }
 };
 
+bool IsAfterCursor(const proto::Message& message, const IStorage::Cursor& cursor) noexcept;
+
+void SortAndTruncate(std::vector<proto::Message>& messages, size_t limit);
+
+// Same for the messages of `sink` starting at `from`, the earlier ones are left untouched.
+void SortAndTruncate(google::protobuf::RepeatedPtrField<proto::Message>* sink, int from, size_t limit);
+
 }  // namespace storage
@@ -20,13 +20,24 @@ class StorageLock {
         mutex_.acquire();
         break;
       case IStorage::LockType::kSpinLock:
-        mutex_.acquire();
+        lock_.acquire();
         break;
       default:
         break;
     }
   }
 
+  inline bool tryAcquire() noexcept {
+    switch (lock_type_) {
+      case IStorage::LockType::kMutex:
+        return mutex_.tryAcquire();
+      case IStorage::LockType::kSpinLock:
+        return lock_.tryAcquire();
+      default:
+        return true;
+    }
+  }
+
   inline void release() noexcept {
     switch (lock_type_) {
       case IStorage::LockType::kMutex: